@@ -1,9 +1,219 @@
 #include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
 #include "legalizer/legalizer.h"
 #include "util/strOperation.h"
 #include "physical/ntkObject.h"
+#include "util/dbu.h"
+#include "util/logger.h"
+#include "util/profiler.h"
+#include "util/compressedInput.h"
+#include "util/defSectionIndex.h"
+#include "physical/netlistCSR.h"
+#include "physical/rowIndex.h"
+#include "physical/hpwl.h"
+
+namespace {
+
+struct RowRecord {
+    Dbu x = 0, y = 0;
+    std::string site;
+    std::string orient = "N";
+    int numX = 1, numY = 1;
+    Dbu stepX = 0, stepY = 0;
+};
+
+Row::orient rowOrient(const std::string& orient) {
+    if (orient == "FS") return Row::FS;
+    if (orient == "S") return Row::S;
+    if (orient == "FN") return Row::FN;
+    return Row::N;
+}
+
+// Creates the chip rows from every ROW record (expanding DO/BY/STEP) and
+// builds the y -> row index. Records with the same y (a row split around
+// macros) form one row spanning all of them. A row's height and type come
+// from the height of its SITE (siteHeight, learned from the LEF); a site
+// without a known height falls back to the distance to the next row. A
+// design with a single one-row ROW record keeps the old behavior of
+// synthesizing alternating SHORT/TALL rows up to the die height.
+bool buildRows(Chip* chip, const std::vector<RowRecord>& rowRecordList,
+               const std::unordered_map<std::string, Dbu>& siteHeight) {
+    if (rowRecordList.empty()) return true;
+
+    struct RowSpec {
+        Dbu x1, y1, x2;
+        Dbu height;     // -1 if the site height is unknown
+        Row::orient orient;
+    };
+    std::vector<RowSpec> specList;
+    for (const RowRecord& rec : rowRecordList) {
+        auto siteIt = siteHeight.find(rec.site);
+        Dbu height = (siteIt != siteHeight.end()) ? siteIt->second : -1;
+        for (int j = 0; j < rec.numY; ++j) {
+            Dbu y = rec.y + j * rec.stepY;
+            Dbu stepX = rec.stepX ? rec.stepX : chip->siteWidth();
+            specList.push_back({rec.x, y, rec.x + stepX * rec.numX, height, rowOrient(rec.orient)});
+        }
+    }
+    std::stable_sort(specList.begin(), specList.end(),
+                     [](const RowSpec& a, const RowSpec& b) { return a.y1 < b.y1; });
+
+    // Merge the segments of each y into one row
+    size_t numRows = 0;
+    for (size_t s = 0; s < specList.size(); ++s) {
+        if (numRows > 0 && specList[numRows - 1].y1 == specList[s].y1) {
+            RowSpec& row = specList[numRows - 1];
+            row.x1 = std::min(row.x1, specList[s].x1);
+            row.x2 = std::max(row.x2, specList[s].x2);
+            row.height = std::max(row.height, specList[s].height);
+        }
+        else {
+            specList[numRows++] = specList[s];
+        }
+    }
+    specList.resize(numRows);
+
+    const RowRecord& first = rowRecordList.front();
+    chip->setNumSites(first.numX);
+    if (first.stepX) {
+        chip->setSiteWidth(first.stepX);
+    }
+
+    if (rowRecordList.size() == 1 && specList.size() == 1) {
+        Dbu x1 = specList[0].x1, y1 = specList[0].y1;
+        Dbu x2 = x1 + chip->siteWidth() * chip->numSites();
+        Dbu y2 = y1 + chip->shortRowHeight();
+        chip->addRow(new Row(x1, y1, x2, y2, Row::SHORT, Row::N));
+        int numRows = chip->boundary().height() / (y2-y1);
+        for (int i = 1; i < numRows; i++) {
+            if (i % 2 == 0) {
+                y1 += chip->shortRowHeight();
+                y2 += chip->shortRowHeight();
+                chip->addRow(new Row(x1, y1, x2, y2, Row::SHORT, Row::FS));
+            }
+            else {
+                y1 += chip->tallRowHeight();
+                y2 += chip->tallRowHeight();
+                chip->addRow(new Row(x1, y1, x2, y2, Row::TALL, Row::N));
+            }
+        }
+    }
+    else {
+        // Without a site height, a row is as high as the distance to the next
+        // row; the top row takes the type that alternates with the row below
+        Dbu shortHeight = chip->shortRowHeight(), tallHeight = chip->tallRowHeight();
+        bool prevShort = false;
+        for (size_t r = 0; r < specList.size(); ++r) {
+            Dbu height = specList[r].height;
+            if (height <= 0 && r + 1 < specList.size()) {
+                height = specList[r + 1].y1 - specList[r].y1;
+            }
+            bool isShort = (height > 0) ? std::llabs(height - shortHeight) <= std::llabs(height - tallHeight)
+                                        : !prevShort;
+            if (specList[r].height <= 0) {
+                height = isShort ? shortHeight : tallHeight;
+            }
+            if (r + 1 < specList.size() && specList[r].y1 + height > specList[r + 1].y1) {
+                LOG_ERROR("ROW at y " << specList[r].y1 << " (height " << height
+                          << ") overlaps the ROW at y " << specList[r + 1].y1 << "\n");
+                return false;
+            }
+            chip->addRow(new Row(specList[r].x1, specList[r].y1, specList[r].x2, specList[r].y1 + height,
+                                 isShort ? Row::SHORT : Row::TALL, specList[r].orient));
+            prevShort = isShort;
+        }
+    }
+
+    chip->rowIndex().build(chip->rowList(), chip->siteWidth());
+    chip->rowIndex().assignNodes(chip->nodeList());
+
+    // Used width of every row; applyGateSwaps keeps it up to date
+    const RowIndex& rowIndex = chip->rowIndex();
+    for (int r = 0; r < rowIndex.numRows(); ++r) {
+        Dbu usedWidth = 0;
+        for (auto [it, end] = rowIndex.nodesOnRow(r); it != end; ++it) {
+            usedWidth += chip->nodeList()[*it]->libGate()->width();
+        }
+        chip->rowList()[r]->setUsedWidth(usedWidth);
+    }
+    return true;
+}
+
+// Sections that parseInputDef indexes and skips ("<NAME> <count> ; ... END <NAME>")
+bool deferredSection(const std::string& keyword) {
+    return keyword == "NETS" || keyword == "PINS" || keyword == "SPECIALNETS" || keyword == "VIAS"
+        || keyword == "BLOCKAGES" || keyword == "FILLS" || keyword == "GROUPS" || keyword == "REGIONS";
+}
+
+// NETS section, from just after the NETS keyword to its last net; builds the
+// Wire objects and the NetlistCSR
+void parseNets(Chip* chip, CompressedInput& input) {
+    PROFILE_SCOPE("parseInputDef/NETS");
+    std::string data;
+    int numNets;
+    std::string netName;
+
+    input >> data;
+    numNets = std::stoi(data);
+    PROFILE_COUNT("nets", numNets);
+    input >> data;
+
+    NetlistCSR& csr = chip->netlistCSR();
+    csr.clear();
+    csr.reserve(numNets, 3 * (size_t)numNets);
+
+    for (int i = 0; i < numNets; i++) {
+        input >> data;
+        input >> netName;
+        Wire* wire = new Wire(netName);
+        csr.beginNet();
+
+        while (true) {
+            input >> data;
+            if (data == ";" || data.empty()) break;
+            if (data == "(") {
+                std::string nodeName, pinName;
+                input >> nodeName >> pinName;
+
+                if (!pinName.empty() && pinName.back() == ')') {
+                    pinName.pop_back();
+                }
+
+                if (nodeName == "PIN") {
+                    // ex: ( PIN key1_20_ )
+                } else {
+                    if (chip->nodeName2Idx().count(nodeName)) {
+                        int nodeIdx = chip->nodeName2Idx().at(nodeName);
+                        Node* node = chip->nodeList().at(nodeIdx);
+
+                        if (node->pinName2Idx().count(pinName)) {
+                            int pinIdx = node->pinName2Idx().at(pinName);
+                            Pin* pin = node->pinList().at(pinIdx);
+
+                            wire->addPin(pin);
+                            pin->setWire(wire);
+                            csr.addPin(nodeIdx, pinIdx, pin->direction() == Pin::OUT);
+                        } else {
+                            LOG_ERROR("Pin " << pinName << " not found in node " << nodeName << "\n");
+                        }
+                    } else {
+                        LOG_ERROR("Node " << nodeName << " not found in chip\n");
+                    }
+                }
+            }
+        }
+        chip->addWire(wire);
+        chip->addWireName2Idx(netName, chip->wireList().size() - 1);
+    }
+    csr.finalize(chip->nodeList().size());
+}
+
+} // namespace
 
 bool Legalizer::parseInput(int argc, char **argv) {
+    PROFILE_SCOPE("parseInput");
     assert ((argc == 5) &&
             (std::string(argv[1]) == "-l" || std::string(argv[1]) == "--legalize"));
 
@@ -68,27 +278,42 @@ bool Legalizer::parseInputMacroLef(std::string inputName) {
     // Parse it 
 
     // std::cout << "parseInputMacroLef"<< "\n";
-    std::cout << "Parsing " << inputName << "\n";
-    IOPkg input(true, false, inputName, "");
+    PROFILE_SCOPE("parseInputMacroLef/" + inputName);
+    LOG_INFO("Parsing " << inputName << "\n");
+    // Plain, gzip or zstd; decompressed on a background thread
+    CompressedInput input(inputName);
     if (!input.inputExist()) {
-        std::cout << "Failed to open " << inputName << "\n";
+        LOG_ERROR("Failed to open " << inputName << ": " << input.error() << "\n");
         return false;
     }
 
     // std::cout << "Start" << "\n";
     std::string data;
-    std::string macroName;
-    float width = 0, height = 0;
+    std::string macroName, macroSite;
+    Dbu width = 0, height = 0;
     LibGate* currentLibGate = nullptr;
 
     while (!input.inputFinish()) {
         input >> data;
 
-        if (data == "MACRO") {
+        if (data == "DATABASE") {
+            // UNITS DATABASE MICRONS <dbuPerMicron> ;
+            input >> data >> data;
+            int dbuPerMicron = std::stoi(data);
+            // Gates already parsed (from the other LEF) are in the chip's DBU
+            if (!chip->libGateList().empty() && dbuPerMicron != chip->dbuPerMicron()) {
+                LOG_ERROR(inputName << ": DATABASE MICRONS " << dbuPerMicron
+                          << " differs from " << chip->dbuPerMicron() << " of the LEF parsed before\n");
+                return false;
+            }
+            chip->setDbuPerMicron(dbuPerMicron);
+        }
+        else if (data == "MACRO") {
             input >> macroName;
             // std::cout << "Found MACRO: " << macroName << "\n";
 
             currentLibGate = new LibGate(macroName, 0, 0, 0, 0, macroName, LibGate::SR_SHORT);
+            PROFILE_COUNT("libGates", 1);
             chip->addLibGate(currentLibGate);
             chip->addLibGateName2Idx(macroName, chip->libGateList().size() - 1);
         }
@@ -96,13 +321,17 @@ bool Legalizer::parseInputMacroLef(std::string inputName) {
             std::string widthStr, heightStr;
 
             input >> widthStr >> data >> heightStr;
-            width = std::stof(widthStr);
-            height = std::stof(heightStr);
+            width = parseDbu(widthStr, chip->dbuPerMicron());
+            height = parseDbu(heightStr, chip->dbuPerMicron());
 
             if (currentLibGate) {
-                *currentLibGate = LibGate(macroName, 0, 0, width, height, macroName, LibGate::SR_SHORT);
+                // The row type a gate needs follows from its height
+                Dbu shortDiff = std::llabs(height - chip->shortRowHeight());
+                Dbu tallDiff = std::llabs(height - chip->tallRowHeight());
+                auto rowType = (shortDiff <= tallDiff) ? LibGate::SR_SHORT : LibGate::SR_TALL;
+                *currentLibGate = LibGate(macroName, 0, 0, width, height, macroName, rowType);
             } else {
-                std::cerr << "Error: No valid LibGate to set SIZE." << std::endl;
+                LOG_ERROR("No valid LibGate to set SIZE.\n");
                 return false;
             }
         }
@@ -112,7 +341,7 @@ bool Legalizer::parseInputMacroLef(std::string inputName) {
             // std::cout << "Found PIN: " << pinName << "\n";
 
             if (!currentLibGate) {
-                std::cerr << "Error: Found PIN but no current MACRO (LibGate)." << std::endl;
+                LOG_ERROR("Found PIN but no current MACRO (LibGate).\n");
                 return false;
             }
 
@@ -136,7 +365,7 @@ bool Legalizer::parseInputMacroLef(std::string inputName) {
                 }
 
                 if (data == "PORT") {
-                    float x1 = -1, y1 = -1, x2 = -1, y2 = -1;
+                    Dbu x1 = -1, y1 = -1, x2 = -1, y2 = -1;
                     std::string x1Str, y1Str, x2Str, y2Str;
 
                     while (data != "END") {
@@ -144,10 +373,10 @@ bool Legalizer::parseInputMacroLef(std::string inputName) {
 
                         if (data == "RECT") {
                             input >> x1Str >> y1Str >> x2Str >> y2Str;
-                            x1 = std::stof(x1Str);
-                            y1 = std::stof(y1Str);
-                            x2 = std::stof(x2Str);
-                            y2 = std::stof(y2Str);
+                            x1 = parseDbu(x1Str, chip->dbuPerMicron());
+                            y1 = parseDbu(y1Str, chip->dbuPerMicron());
+                            x2 = parseDbu(x2Str, chip->dbuPerMicron());
+                            y2 = parseDbu(y2Str, chip->dbuPerMicron());
                         }
                     }
 
@@ -165,6 +394,30 @@ bool Legalizer::parseInputMacroLef(std::string inputName) {
                 }
             }
         }
+        else if (data == "SITE") {
+            std::string siteName;
+            input >> siteName;
+            if (currentLibGate) {
+                // SITE <name> ; of a MACRO: the site is as high as the macro
+                input >> data;
+                macroSite = siteName;
+            }
+            else {
+                // SITE <name> ... SIZE <w> BY <h> ; ... END <name>
+                while (!input.inputFinish()) {
+                    input >> data;
+                    if (data == "SIZE") {
+                        std::string heightStr;
+                        input >> data >> data >> heightStr;
+                        _siteHeight[siteName] = parseDbu(heightStr, chip->dbuPerMicron());
+                    }
+                    else if (data == "END") {
+                        input >> data;
+                        if (data == siteName) break;
+                    }
+                }
+            }
+        }
         else if (data == "OBS") {
             while (data != "END") {
                 input >> data;
@@ -175,10 +428,18 @@ bool Legalizer::parseInputMacroLef(std::string inputName) {
 
             if (data == macroName) {
                 // std::cout << "Ending MACRO: " << macroName << "\n";
+                if (currentLibGate && !macroSite.empty()) {
+                    _siteHeight.emplace(macroSite, currentLibGate->height());
+                }
+                macroSite.clear();
                 currentLibGate = nullptr;
             }
         }
     }
+    if (!input.error().empty()) {
+        LOG_ERROR(input.error() << "\n");
+        return false;
+    }
     // std::cout << "Finish" << "\n";
     // std::cout << "\nParsed LibGates:\n";
     // for (const auto& libGate : chip->libGateList()) {
@@ -192,18 +453,29 @@ bool Legalizer::parseInputLib(std::string inputName) {
     return true;
 }
 
+// DIEAREA, ROW and COMPONENTS are parsed here. NETS and the other list
+// sections (deferredSection) are only indexed in _defSections and skipped by
+// a raw search for their END line, so runs that never touch the netlist do
+// not pay for tokenizing NETS or building the Wires; loadDefNets parses NETS
+// from its recorded offset on first use.
 bool Legalizer::parseInputDef(std::string inputName) {
-    std::cout << "Parsing " << inputName << "\n";
+    PROFILE_SCOPE("parseInputDef");
+    LOG_INFO("Parsing " << inputName << "\n");
 
-    IOPkg input(true, false, inputName, "");
+    // Plain, gzip or zstd; decompressed on a background thread
+    CompressedInput input(inputName);
     if (!input.inputExist()) {
-        std::cout << "Failed to open " << inputName << "\n";
+        LOG_ERROR("Failed to open " << inputName << ": " << input.error() << "\n");
         return false;
     }
 
-    bool firstRow = true;
+    // Geometry is kept in the library DBU (LEF DATABASE MICRONS). LEF/DEF
+    // require the DEF DBU to divide it, so DEF values scale by an integer.
+    std::vector<RowRecord> rowRecordList;
     std::string data;
+    _defSections.reset(inputName);
     int dbuPerMicron = -1;
+    Dbu defScale = 1;
 
     while (!input.inputFinish()) {
         input >> data;
@@ -215,63 +487,71 @@ bool Legalizer::parseInputDef(std::string inputName) {
         else if (data == "UNITS") {
             input >> data >> data >> data;
             dbuPerMicron = std::stoi(data);
+            if (dbuPerMicron <= 0 || chip->dbuPerMicron() % dbuPerMicron != 0) {
+                LOG_ERROR(inputName << ": UNITS DISTANCE MICRONS " << dbuPerMicron
+                          << " does not divide the library's " << chip->dbuPerMicron() << "\n");
+                return false;
+            }
+            defScale = chip->dbuPerMicron() / dbuPerMicron;
         }
         else if (data == "DIEAREA") {
+            PROFILE_SCOPE("parseInputDef/DIEAREA");
+            _defSections.add("DIEAREA", input.offset(), -1, true);
             assert (dbuPerMicron != -1);
-            float x1, y1, x2, y2;
+            Dbu x1, y1, x2, y2;
             input >> data >> data;
-            x1 = std::stof(data)/dbuPerMicron;
+            x1 = std::stoll(data) * defScale;
             input >> data;
-            y1 = std::stof(data)/dbuPerMicron;
+            y1 = std::stoll(data) * defScale;
             input >> data >> data >> data;
-            x2 = std::stof(data)/dbuPerMicron;
+            x2 = std::stoll(data) * defScale;
             input >> data;
-            y2 = std::stof(data)/dbuPerMicron;
+            y2 = std::stoll(data) * defScale;
             input >> data;
             chip->setBoundary(x1, y1, x2, y2);
         }
-        else if (data == "ROW" && firstRow) {
-            float x1, y1, x2, y2;
-            int numX;
-            float stepX;
-            input >> data >> data >> data;
-            x1 = std::stof(data);
+        else if (data == "ROW") {
+            // ROW <name> <site> <x> <y> <orient> [DO <nx> BY <ny> [STEP <sx> <sy>]] ;
+            PROFILE_SCOPE("parseInputDef/ROW");
+            if (rowRecordList.empty()) _defSections.add("ROW", input.offset(), -1, true);
+            RowRecord row;
+            input >> data >> row.site >> data;
+            row.x = std::stoll(data) * defScale;
             input >> data;
-            y1 = std::stof(data);
-            input >> data >> data >> data;
-            numX = std::stoi(data);
-            chip->setNumSites(numX);
-            input >> data >> data >> data >> data;
-            stepX = std::stof(data);
-            chip->setSiteWidth(stepX/dbuPerMicron);
-            x2 = x1 + chip->siteWidth() * chip->numSites();
-            y2 = y1 + chip->shortRowHeight();
-            chip->addRow(new Row(x1, y1, x2, y2, Row::SHORT, Row::N));
-            int numRows = floor(chip->boundary().height() / (y2-y1));
-            for (int i = 1; i < numRows; i++) {
-                if (i % 2 == 0) {
-                    y1 += chip->shortRowHeight();
-                    y2 += chip->shortRowHeight();
-                    chip->addRow(new Row(x1, y1, x2, y2, Row::SHORT, Row::FS));
-                }
-                else {
-                    y1 += chip->tallRowHeight();
-                    y2 += chip->tallRowHeight();
-                    chip->addRow(new Row(x1, y1, x2, y2, Row::TALL, Row::N));
+            row.y = std::stoll(data) * defScale;
+            input >> row.orient;
+            input >> data;
+            if (data == "DO") {
+                input >> data;
+                row.numX = std::stoi(data);
+                input >> data >> data;
+                row.numY = std::stoi(data);
+                input >> data;
+                if (data == "STEP") {
+                    input >> data;
+                    row.stepX = std::stoll(data) * defScale;
+                    input >> data;
+                    row.stepY = std::stoll(data) * defScale;
+                    input >> data;
                 }
             }
-            firstRow = false;
+            rowRecordList.push_back(row);
         }
         else if (data == "COMPONENTS") {
+            PROFILE_SCOPE("parseInputDef/COMPONENTS");
             int numComps;
             std::string compName, modelName;
-            float x1, y1, x2, y2;
+            Dbu x1, y1, x2, y2;
             Node::orient orient;
             LibGate* libGate;
 
+            size_t offset = input.offset();
             input >> data;
             numComps = std::stoi(data);
+            _defSections.add("COMPONENTS", offset, numComps, true);
+            PROFILE_COUNT("components", numComps);
             input >> data;
+            const auto& libGateMap = chip->libGateName2Idx();
 
             for (int i = 0; i < numComps; i++) {
                 input >> data >> data;
@@ -282,11 +562,10 @@ bool Legalizer::parseInputDef(std::string inputName) {
                     input >> data;
                 }
                 input >> data;
-                std::cout << data << "\n";
-                x1 = std::stof(data)/dbuPerMicron;
-                std::cout << "x1: " << x1 << "\n";
+                x1 = std::stoll(data) * defScale;
+                LOG_TRACE(compName << " x1: " << x1 << "\n");
                 input >> data;
-                y1 = std::stof(data)/dbuPerMicron;
+                y1 = std::stoll(data) * defScale;
                 input >> data >> data;
 
                 Node::orient orient;
@@ -304,11 +583,9 @@ bool Legalizer::parseInputDef(std::string inputName) {
                 }
                 input >> data;
                 
-                auto libGateMap = chip->libGateName2Idx();
-                
-                if (libGateMap.find(modelName) != libGateMap.end()) {
-                    int gateIndex = libGateMap.at(modelName);
-                    libGate = chip->libGateList().at(gateIndex);
+                auto gateIt = libGateMap.find(modelName);
+                if (gateIt != libGateMap.end()) {
+                    libGate = chip->libGateList().at(gateIt->second);
                     x2 = x1 + libGate->width();
                     y2 = y1 + libGate->height();
 
@@ -324,65 +601,16 @@ bool Legalizer::parseInputDef(std::string inputName) {
                 }
             }
         }
-        else if (data == "PINS") {
-            // int numPins;
-            // std::string pinName, netName;
-            // Pin::direction direction;
-            // input >> data;
-            // numPins = std::stoi(data);
-            // input >> data;
-            // for (int i = 0; i < numPins; i++) {
-
-            // }
-        }
-        else if (data == "NETS") {
-            int numNets;
-            std::string netName;
-
-            input >> data;
-            numNets = std::stoi(data);
+        else if (deferredSection(data)) {
+            // Indexed and skipped without tokenizing; NETS is parsed by
+            // loadDefNets when first needed
+            std::string name = data;
+            size_t offset = input.offset();
             input >> data;
-
-            for (int i = 0; i < numNets; i++) {
-                input >> data;
-                input >> netName;
-                Wire* wire = new Wire(netName);
-
-                while (true) {
-                    input >> data;
-                    if (data == ";") break;
-                    if (data == "(") {
-                        std::string nodeName, pinName;
-                        input >> nodeName >> pinName;
-
-                        if (!pinName.empty() && pinName.back() == ')') {
-                            pinName.pop_back();
-                        }
-
-                        if (nodeName == "PIN") {
-                            // ex: ( PIN key1_20_ )
-                        } else {
-                            if (chip->nodeName2Idx().count(nodeName)) {
-                                int nodeIdx = chip->nodeName2Idx().at(nodeName);
-                                Node* node = chip->nodeList().at(nodeIdx);
-
-                                if (node->pinName2Idx().count(pinName)) {
-                                    int pinIdx = node->pinName2Idx().at(pinName);
-                                    Pin* pin = node->pinList().at(pinIdx);
-
-                                    wire->addPin(pin);
-                                    pin->setWire(wire);
-                                } else {
-                                    std::cerr << "Error: Pin " << pinName << " not found in node " << nodeName << "\n";
-                                }
-                            } else {
-                                std::cerr << "Error: Node " << nodeName << " not found in chip\n";
-                            }
-                        }
-                    }
-                }
-                chip->addWire(wire);
-                chip->addWireName2Idx(netName, chip->wireList().size() - 1);
+            _defSections.add(name, offset, std::stoll(data), false);
+            if (!input.skipPast("END " + name)) {
+                LOG_ERROR(inputName << ": missing END " << name << "\n");
+                return false;
             }
         }
         else if (data == "END") {
@@ -390,8 +618,48 @@ bool Legalizer::parseInputDef(std::string inputName) {
         }
     }
 
+    if (!input.error().empty()) {
+        LOG_ERROR(input.error() << "\n");
+        return false;
+    }
+    if (!buildRows(chip, rowRecordList, _siteHeight)) {
+        return false;
+    }
+    // The netlist of the previous design must not be seen before NETS loads;
+    // without a NETS section it is empty and complete
+    chip->netlistCSR().clear();
+    if (!_defSections.find("NETS")) {
+        chip->netlistCSR().finalize(chip->nodeList().size());
+    }
+
     // chip->print();
     // std::cout << "Parsing completed \n";
 
     return true;
-}
\ No newline at end of file
+}
+
+bool Legalizer::loadDefNets() {
+    DefSection* section = _defSections.find("NETS");
+    if (!section || section->loaded) return true;
+    PROFILE_SCOPE("loadDefNets");
+    LOG_INFO("Parsing NETS of " << _defSections.fileName() << "\n");
+
+    CompressedInput input(_defSections.fileName(), section->offset);
+    if (!input.inputExist()) {
+        LOG_ERROR("Failed to open " << _defSections.fileName() << ": " << input.error() << "\n");
+        return false;
+    }
+    parseNets(chip, input);
+    if (!input.error().empty()) {
+        LOG_ERROR(input.error() << "\n");
+        return false;
+    }
+    section->loaded = true;
+    return true;
+}
+
+bool Legalizer::buildHpwl(HpwlEvaluator& hpwl, int numThreads) {
+    if (!loadDefNets()) return false;
+    hpwl.build(chip, numThreads);
+    return true;
+}
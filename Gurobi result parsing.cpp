@@ -0,0 +1,252 @@
+#include <cassert>
+#include <algorithm>
+#include <cctype>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "legalizer/legalizer.h"
+#include "util/strOperation.h"
+#include "physical/ntkObject.h"
+#include "util/dbu.h"
+#include "util/logger.h"
+#include "util/profiler.h"
+#include "physical/netlistCSR.h"
+
+/*
+Result file written by the generated Gurobi program (NIMCH_gurobi_result.txt):
+    <intNode> <gate>
+    ...
+Every line selects libGate <gate> for node <intNode>. The swaps are resolved
+serially through nodeName2Idx / libGateName2Idx and then applied in one
+parallel pass over disjoint node ranges, which moves each node to its new
+gate's size and pins. A successful parse promotes the pending ECO snapshot
+of the run that produced the result (see _genGurobiEco).
+*/
+
+bool Legalizer::parseGurobiResult(std::string inputName) {
+    PROFILE_SCOPE("parseGurobiResult");
+    LOG_INFO("Parsing " << inputName << "\n");
+    // applyGateSwaps checks the pins' wires and remaps the NetlistCSR
+    if (!loadDefNets()) {
+        return false;
+    }
+
+    int fd = open(inputName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open " << inputName << "\n");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        LOG_ERROR("Failed to open " << inputName << "\n");
+        return false;
+    }
+    size_t fileSize = st.st_size;
+    if (fileSize == 0) {
+        close(fd);
+        return _promoteEcoSnapshot();
+    }
+    const char* buf = (const char*)mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED) {
+        LOG_ERROR("Failed to map " << inputName << "\n");
+        return false;
+    }
+    madvise((void*)buf, fileSize, MADV_SEQUENTIAL);
+
+    // Resolve names to indices
+    const auto& nodeMap = chip->nodeName2Idx();
+    const auto& libGateMap = chip->libGateName2Idx();
+    // (nodeIdx, libGateIdx); a node listed twice keeps its last gate, so every
+    // node appears at most once and the apply pass needs no locking
+    std::vector<std::pair<int, int>> swapList;
+    std::vector<int> swapIdx(chip->nodeList().size(), -1);
+    swapList.reserve(fileSize / 24);
+
+    std::string nodeName, gateName;
+    const char* p = buf;
+    const char* end = buf + fileSize;
+    while (p < end) {
+        while (p < end && isspace(*p)) ++p;
+        const char* nodeBegin = p;
+        while (p < end && !isspace(*p)) ++p;
+        const char* nodeEnd = p;
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        const char* gateBegin = p;
+        while (p < end && !isspace(*p)) ++p;
+        const char* gateEnd = p;
+        if (nodeBegin == nodeEnd) break;
+        if (gateBegin == gateEnd) {
+            LOG_ERROR("Missing gate for node " << std::string(nodeBegin, nodeEnd) << "\n");
+            continue;
+        }
+
+        nodeName.assign(nodeBegin, nodeEnd);
+        gateName.assign(gateBegin, gateEnd);
+        auto nodeIt = nodeMap.find(nodeName);
+        if (nodeIt == nodeMap.end()) {
+            LOG_ERROR("Node " << nodeName << " not found in chip\n");
+            continue;
+        }
+        auto gateIt = libGateMap.find(gateName);
+        if (gateIt == libGateMap.end()) {
+            LOG_ERROR("LibGate " << gateName << " not found in library\n");
+            continue;
+        }
+        int nodeIdx = nodeIt->second;
+        if (swapIdx[nodeIdx] != -1) {
+            swapList[swapIdx[nodeIdx]].second = gateIt->second;
+        }
+        else {
+            swapIdx[nodeIdx] = swapList.size();
+            swapList.push_back({nodeIdx, gateIt->second});
+        }
+    }
+    munmap((void*)buf, fileSize);
+    PROFILE_COUNT("gateSwaps", swapList.size());
+
+    applyGateSwaps(swapList);
+    return _promoteEcoSnapshot();
+}
+
+void Legalizer::applyGateSwaps(const std::vector<std::pair<int, int>>& swapList) {
+    PROFILE_SCOPE("applyGateSwaps");
+    const auto& nodeList = chip->nodeList();
+    const auto& libGateList = chip->libGateList();
+    const auto& rowList = chip->rowList();
+    const size_t numRows = rowList.size();
+    const Dbu shortRowHeight = chip->shortRowHeight();
+
+    unsigned numThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (swapList.size() < 4096) numThreads = 1;
+    size_t chunk = (swapList.size() + numThreads - 1) / numThreads;
+
+    // Each thread keeps its own per-row width delta and counters; they are
+    // reduced afterwards so the hot loop never writes to shared row state.
+    std::vector<std::vector<Dbu>> rowWidthDelta(numThreads, std::vector<Dbu>(numRows, 0));
+    std::vector<size_t> numRejected(numThreads, 0), numWrongRow(numThreads, 0);
+    // Gate each swapped node had before, for remapping its CSR pins
+    std::vector<LibGate*> oldGateList(swapList.size(), nullptr);
+
+    auto applyRange = [&](unsigned t, size_t begin, size_t end) {
+        std::vector<Dbu>& delta = rowWidthDelta[t];
+        for (size_t s = begin; s < end; ++s) {
+            Node* node = nodeList[swapList[s].first];
+            LibGate* oldGate = node->libGate();
+            LibGate* newGate = libGateList[swapList[s].second];
+            if (oldGate == newGate) continue;
+
+            // A connected pin must exist on the new gate, or the net would
+            // silently lose it
+            std::vector<Pin*>& pinList = node->pinList();
+            bool connected = true;
+            for (Pin* pin : pinList) {
+                if (pin->wire() && !newGate->pinName2Idx().count(pin->name())) connected = false;
+            }
+            if (!connected) {
+                ++numRejected[t];
+                continue;
+            }
+            oldGateList[s] = oldGate;
+
+            // Geometry: keep the lower-left corner, resize to the new gate
+            Dbu x1 = node->boundary().x1();
+            Dbu y1 = node->boundary().y1();
+            node->setLibGate(newGate);
+            node->setBoundary(x1, y1, x1 + newGate->width(), y1 + newGate->height());
+
+            // Row-utilization bookkeeping. The row type a node needs follows
+            // its gate's height, so a node left on a row of the other height
+            // has to be legalized onto a matching row.
+            int rowIdx = chip->rowIndex().rowAt(y1);
+            if (rowIdx != -1) {
+                delta[rowIdx] += newGate->width() - oldGate->width();
+                Dbu rowHeight = chip->rowIndex().rowY2(rowIdx) - chip->rowIndex().rowY1(rowIdx);
+                if ((newGate->height() > shortRowHeight) != (rowHeight > shortRowHeight)) ++numWrongRow[t];
+            }
+
+            // Pin bindings: rebuild the node's pins in the new gate's pin
+            // order. A pin of the same name is kept, so its wire still points
+            // at it, and takes the new gate's ports; pins only on the new gate
+            // are created unconnected, pins only on the old gate are dropped.
+            std::vector<Pin*> oldPinList;
+            oldPinList.swap(pinList);
+            node->pinName2Idx().clear();
+            for (Pin* libPin : newGate->pinList()) {
+                Pin* nodePin = nullptr;
+                for (Pin*& oldPin : oldPinList) {
+                    if (oldPin && oldPin->name() == libPin->name()) {
+                        nodePin = oldPin;
+                        oldPin = nullptr;
+                        break;
+                    }
+                }
+                if (nodePin) {
+                    nodePin->portList() = libPin->portList();
+                }
+                else {
+                    nodePin = new Pin(*libPin);
+                }
+                node->addPin(nodePin);
+                node->addPinName2Idx(nodePin->name(), node->pinList().size() - 1);
+            }
+            for (Pin* oldPin : oldPinList) {
+                delete oldPin;
+            }
+        }
+    };
+
+    std::vector<std::thread> threadList;
+    for (unsigned t = 1; t < numThreads; ++t) {
+        size_t begin = t * chunk;
+        size_t end = std::min(swapList.size(), begin + chunk);
+        if (begin >= end) break;
+        threadList.emplace_back(applyRange, t, begin, end);
+    }
+    applyRange(0, 0, std::min(swapList.size(), chunk));
+    for (auto& thread : threadList) {
+        thread.join();
+    }
+
+    for (size_t r = 0; r < numRows; ++r) {
+        Dbu delta = 0;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            delta += rowWidthDelta[t][r];
+        }
+        if (delta != 0) {
+            rowList[r]->setUsedWidth(rowList[r]->usedWidth() + delta);
+        }
+    }
+
+    // Node pin indices now follow the new gates; move the CSR pins of the
+    // swapped nodes (if NETS is loaded) to the index of the same-name pin
+    NetlistCSR& csr = chip->netlistCSR();
+    if (csr.numPins() > 0) {
+        std::vector<int> swapOf(nodeList.size(), -1);
+        for (size_t s = 0; s < swapList.size(); ++s) {
+            if (oldGateList[s]) swapOf[swapList[s].first] = s;
+        }
+        for (int p = 0; p < csr.numPins(); ++p) {
+            int s = swapOf[csr.pinNode[p]];
+            if (s == -1) continue;
+            const std::string& pinName = oldGateList[s]->pinList()[csr.pinLibPin[p]]->name();
+            csr.pinLibPin[p] = libGateList[swapList[s].second]->pinName2Idx().at(pinName);
+        }
+    }
+
+    size_t rejected = 0, wrongRow = 0;
+    for (unsigned t = 0; t < numThreads; ++t) {
+        rejected += numRejected[t];
+        wrongRow += numWrongRow[t];
+    }
+    if (rejected > 0) {
+        LOG_WARN(rejected << " gate swaps skipped: a connected pin does not exist on the new gate\n");
+    }
+    if (wrongRow > 0) {
+        LOG_INFO(wrongRow << " nodes now need a row of the other height\n");
+    }
+}
@@ -0,0 +1,358 @@
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "legalizer/legalizer.h"
+#include "util/strOperation.h"
+#include "physical/ntkObject.h"
+#include "util/logger.h"
+
+/*
+Synthetic designs and end-to-end benchmark
+    -g/--gen-bench <outPrefix> <numCells> <avgFanout> <utilization> [seed]
+        writes <outPrefix>_8T.macro.lef, <outPrefix>_12T.macro.lef and
+        <outPrefix>.def in the subset of LEF/DEF that parseInputMacroLef and
+        parseInputDef read (NanGate-style cell names, alternating 8T/12T rows)
+    -b/--benchmark <libraryPath> <inputDef> <repeats> <outJson>
+        times each parse / generation phase over <repeats> fresh runs and
+        writes median, p95, throughput and peak RSS per phase as JSON
+        (MB/s is input size for the parsers, output size for _genGurobi)
+*/
+
+namespace {
+
+struct BenchCell {
+    const char* logic;
+    int numInputs;
+    int baseSites;
+};
+
+// Logic functions of the synthetic library; every function comes in X1/X2/X4
+// drives, each X doubling adds one site
+const BenchCell benchCellList[] = {
+    {"INV", 1, 2}, {"BUF", 1, 3}, {"NAND2", 2, 3}, {"NOR2", 2, 3}, {"AND2", 2, 4},
+    {"OR2", 2, 4}, {"XOR2", 2, 6}, {"AOI21", 3, 4}, {"OAI21", 3, 4}, {"NAND3", 3, 4},
+};
+const int benchDriveList[] = {1, 2, 4};
+const char* benchInputPinList[] = {"A1", "A2", "A3"};
+
+const int benchDbuPerMicron = 1000;
+const int benchSiteWidth = 64;      // DBU
+const int benchShortHeight = 512;   // DBU, 8T
+const int benchTallHeight = 768;    // DBU, 12T
+
+int benchSites(const BenchCell& cell, int drive) {
+    return cell.baseSites + (drive == 1 ? 0 : drive == 2 ? 1 : 2);
+}
+
+std::string benchMacroName(const BenchCell& cell, int drive, bool tall) {
+    return std::string(cell.logic) + "_X" + std::to_string(drive) + (tall ? "_12T" : "_8T");
+}
+
+bool writeBenchLef(const std::string& fileName, bool tall) {
+    std::ofstream outFile(fileName);
+    if (!outFile.is_open()) return false;
+    double height = (tall ? benchTallHeight : benchShortHeight) / (double)benchDbuPerMicron;
+    double siteWidth = benchSiteWidth / (double)benchDbuPerMicron;
+
+    outFile << "VERSION 5.8 ;\nBUSBITCHARS \"[]\" ;\nDIVIDERCHAR \"/\" ;\n\n"
+            << "UNITS\n  DATABASE MICRONS " << 2 * benchDbuPerMicron << " ;\nEND UNITS\n\n";
+    for (const BenchCell& cell : benchCellList) {
+        for (int drive : benchDriveList) {
+            std::string name = benchMacroName(cell, drive, tall);
+            double width = benchSites(cell, drive) * siteWidth;
+            outFile << "MACRO " << name << "\n"
+                    << "  CLASS CORE ;\n"
+                    << "  ORIGIN 0 0 ;\n"
+                    << "  SIZE " << width << " BY " << height << " ;\n"
+                    << "  SYMMETRY X Y ;\n"
+                    << "  SITE " << (tall ? "CoreSite12T" : "CoreSite8T") << " ;\n";
+            for (int p = 0; p <= cell.numInputs; ++p) {
+                bool isOutput = (p == cell.numInputs);
+                double x = (p + 0.5) * siteWidth;
+                outFile << "  PIN " << (isOutput ? "Z" : benchInputPinList[p]) << "\n"
+                        << "    DIRECTION " << (isOutput ? "OUTPUT" : "INPUT") << " ;\n"
+                        << "    USE SIGNAL ;\n"
+                        << "    PORT\n"
+                        << "      LAYER M1 ;\n"
+                        << "        RECT " << x - 0.01 << " " << 0.1 * height << " "
+                        << x + 0.01 << " " << 0.9 * height << " ;\n"
+                        << "    END\n"
+                        << "  END " << (isOutput ? "Z" : benchInputPinList[p]) << "\n";
+            }
+            for (const char* pgPin : {"VDD", "VSS"}) {
+                outFile << "  PIN " << pgPin << "\n"
+                        << "    DIRECTION INOUT ;\n"
+                        << "    USE " << (pgPin[1] == 'D' ? "POWER" : "GROUND") << " ;\n"
+                        << "    PORT\n"
+                        << "      LAYER M1 ;\n"
+                        << "        RECT 0 " << (pgPin[1] == 'D' ? height - 0.02 : 0.0) << " "
+                        << width << " " << (pgPin[1] == 'D' ? height : 0.02) << " ;\n"
+                        << "    END\n"
+                        << "  END " << pgPin << "\n";
+            }
+            outFile << "END " << name << "\n\n";
+        }
+    }
+    outFile << "END LIBRARY\n";
+    return true;
+}
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return (n % 2) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+double percentile(std::vector<double> v, double p) {
+    std::sort(v.begin(), v.end());
+    size_t idx = std::min(v.size() - 1, (size_t)std::ceil(p * v.size()) - 1);
+    return v[idx];
+}
+
+// Resets the process's peak RSS (VmHWM) to its current RSS, so the next
+// readPeakRssKB covers only what runs in between; false where the kernel
+// does not support it
+bool resetPeakRss() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (!clearRefs.is_open()) return false;
+    clearRefs << "5" << std::flush;
+    return (bool)clearRefs;
+}
+
+// VmHWM from /proc/self/status, or ru_maxrss (peak since start) without it
+long readPeakRssKB() {
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key) {
+        if (key == "VmHWM:") {
+            long kb = 0;
+            status >> kb;
+            return kb;
+        }
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+double fileSizeMB(const std::string& fileName) {
+    struct stat st;
+    return stat(fileName.c_str(), &st) == 0 ? st.st_size / 1e6 : 0.0;
+}
+
+} // namespace
+
+bool Legalizer::genBenchmarkDesign(std::string outPrefix, int numCells, double avgFanout,
+                                   double utilization, unsigned seed) {
+    assert (numCells > 0 && avgFanout >= 1 && utilization > 0 && utilization <= 1);
+
+    IOPkg genMsg;
+    genMsg << "Generating benchmark " << outPrefix << " (" << numCells << " cells)\n";
+
+    if (!writeBenchLef(outPrefix + "_8T.macro.lef", false) ||
+        !writeBenchLef(outPrefix + "_12T.macro.lef", true)) {
+        genMsg << "Failed to write " << outPrefix << " LEF\n";
+        return false;
+    }
+
+    std::mt19937_64 rng(seed);
+    const int numTypes = sizeof(benchCellList) / sizeof(benchCellList[0]);
+    std::uniform_int_distribution<int> typeDist(0, numTypes - 1);
+    std::uniform_int_distribution<int> driveDist(0, 2);
+    std::bernoulli_distribution tallDist(0.5);
+
+    // Cell types; a cell is tall with probability 1/2 and goes on a row of its height
+    std::vector<int> cellType(numCells), cellDrive(numCells);
+    std::vector<bool> cellTall(numCells);
+    long long totalSites[2] = {0, 0};
+    for (int i = 0; i < numCells; ++i) {
+        cellType[i] = typeDist(rng);
+        cellDrive[i] = benchDriveList[driveDist(rng)];
+        cellTall[i] = tallDist(rng);
+        totalSites[cellTall[i]] += benchSites(benchCellList[cellType[i]], cellDrive[i]);
+    }
+
+    // Die: roughly square, rows alternate 8T/12T starting with 8T as parseInputDef assumes
+    double cellArea = (totalSites[0] * benchShortHeight + totalSites[1] * benchTallHeight)
+                      * (double)benchSiteWidth;
+    double dieSide = std::sqrt(cellArea / utilization);
+    int numPairs = std::max(1, (int)std::ceil(dieSide / (benchShortHeight + benchTallHeight)));
+    long long numSites = (long long)std::ceil(
+        std::max(totalSites[0], totalSites[1]) / utilization / numPairs) + 16;
+    long long dieWidth = numSites * benchSiteWidth;
+    long long dieHeight = (long long)numPairs * (benchShortHeight + benchTallHeight);
+
+    // Row-by-row placement, spreading each row's cells to meet the utilization
+    std::vector<long long> cellX(numCells), cellY(numCells);
+    for (int tall = 0; tall < 2; ++tall) {
+        std::vector<int> list;
+        for (int i = 0; i < numCells; ++i) {
+            if (cellTall[i] == (bool)tall) list.push_back(i);
+        }
+        size_t perRow = std::max<size_t>(1, (list.size() + numPairs - 1) / numPairs);
+        for (size_t first = 0; first < list.size(); first += perRow) {
+            size_t last = std::min(list.size(), first + perRow);
+            long long usedSites = 0;
+            for (size_t c = first; c < last; ++c) {
+                usedSites += benchSites(benchCellList[cellType[list[c]]], cellDrive[list[c]]);
+            }
+            long long gap = std::max(0LL, (numSites - usedSites) / (long long)(last - first));
+            long long x = 0;
+            long long y = (long long)(first / perRow) * (benchShortHeight + benchTallHeight)
+                          + (tall ? benchShortHeight : 0);
+            for (size_t c = first; c < last; ++c) {
+                cellX[list[c]] = x;
+                cellY[list[c]] = y;
+                x += (benchSites(benchCellList[cellType[list[c]]], cellDrive[list[c]]) + gap) * benchSiteWidth;
+            }
+        }
+    }
+
+    std::ofstream outFile(outPrefix + ".def");
+    if (!outFile.is_open()) {
+        genMsg << "Failed to write " << outPrefix << ".def\n";
+        return false;
+    }
+    outFile << "VERSION 5.8 ;\nDIVIDERCHAR \"/\" ;\nBUSBITCHARS \"[]\" ;\n"
+            << "DESIGN bench" << numCells << " ;\n"
+            << "UNITS DISTANCE MICRONS " << benchDbuPerMicron << " ;\n\n"
+            << "DIEAREA ( 0 0 ) ( " << dieWidth << " " << dieHeight << " ) ;\n\n";
+    for (int r = 0; r < 2 * numPairs; ++r) {
+        long long y = (long long)(r / 2) * (benchShortHeight + benchTallHeight) + ((r % 2) ? benchShortHeight : 0);
+        outFile << "ROW ROW_" << r << " " << ((r % 2) ? "CoreSite12T" : "CoreSite8T") << " 0 " << y
+                << " " << ((r % 4 < 2) ? "N" : "FS") << " DO " << numSites << " BY 1 STEP "
+                << benchSiteWidth << " 0 ;\n";
+    }
+    outFile << "\nCOMPONENTS " << numCells << " ;\n";
+    for (int i = 0; i < numCells; ++i) {
+        outFile << "- g" << i << " " << benchMacroName(benchCellList[cellType[i]], cellDrive[i], cellTall[i])
+                << " + PLACED ( " << cellX[i] << " " << cellY[i] << " ) N ;\n";
+    }
+    outFile << "END COMPONENTS\n\n";
+
+    // One net per cell output; fanout ~ 1 + geometric(avgFanout - 1), sinks are
+    // drawn from a window of later cells so the netlist is acyclic and local
+    std::geometric_distribution<int> fanoutDist(1.0 / avgFanout);
+    std::vector<int> freeInput(numCells);
+    for (int i = 0; i < numCells; ++i) freeInput[i] = benchCellList[cellType[i]].numInputs;
+    const int window = 256;
+    std::vector<std::vector<std::pair<int, int>>> netSinks(numCells);
+    int numNets = 0;
+    for (int i = 0; i < numCells; ++i) {
+        int fanout = std::min(32, 1 + fanoutDist(rng));
+        for (int f = 0, tries = 0; f < fanout && tries < 4 * fanout && i + 1 < numCells; ++tries) {
+            std::uniform_int_distribution<int> sinkDist(i + 1, std::min(numCells - 1, i + window));
+            int sink = sinkDist(rng);
+            if (freeInput[sink] == 0) continue;
+            int pin = benchCellList[cellType[sink]].numInputs - freeInput[sink]--;
+            netSinks[i].push_back({sink, pin});
+            ++f;
+        }
+        if (!netSinks[i].empty()) ++numNets;
+    }
+    outFile << "NETS " << numNets << " ;\n";
+    for (int i = 0; i < numCells; ++i) {
+        if (netSinks[i].empty()) continue;
+        outFile << "- n" << i << " ( g" << i << " Z )";
+        for (const auto& sink : netSinks[i]) {
+            outFile << " ( g" << sink.first << " " << benchInputPinList[sink.second] << " )";
+        }
+        outFile << " ;\n";
+    }
+    outFile << "END NETS\n\nEND DESIGN\n";
+    outFile.close();
+
+    genMsg << "Generated " << outPrefix << ".def (" << numNets << " nets, "
+           << 2 * numPairs << " rows)\n";
+    return true;
+}
+
+bool Legalizer::runBenchmark(int argc, char **argv) {
+    assert ((argc == 6) &&
+            (std::string(argv[1]) == "-b" || std::string(argv[1]) == "--benchmark"));
+
+    std::string inputLibraryPath = argv[2];
+    std::string inputDef = argv[3];
+    int repeats = std::max(1, std::stoi(argv[4]));
+    std::string outJson = argv[5];
+
+    struct Phase {
+        std::string name;
+        std::string inputName;
+        std::vector<double> seconds;
+        size_t numCells = 0;
+        long peakRssKB = 0;
+    };
+    std::vector<Phase> phaseList = {
+        {"parseInputMacroLef_8T", inputLibraryPath + "_8T.macro.lef"},
+        {"parseInputMacroLef_12T", inputLibraryPath + "_12T.macro.lef"},
+        {"parseInputDef", inputDef},
+        {"genGurobi", "NIMCH_gurobi_model.txt"},
+    };
+
+    // Peak RSS per phase: the kernel's high-water mark is reset before each
+    // phase; where that is not supported, the growth of the process peak
+    // during the phase is reported instead
+    bool peakReset = true;
+    using clock = std::chrono::steady_clock;
+    for (int rep = 0; rep < repeats; ++rep) {
+        delete chip;
+        chip = new Chip();
+        _clearDelayTables();
+        for (size_t p = 0; p < phaseList.size(); ++p) {
+            Phase& phase = phaseList[p];
+            peakReset = resetPeakRss() && peakReset;
+            long peakBefore = readPeakRssKB();
+            size_t numGatesBefore = chip->libGateList().size();
+            auto start = clock::now();
+            bool ok = (p < 2) ? parseInputMacroLef(phase.inputName)
+                    : (p == 2) ? parseInputDef(phase.inputName) && loadDefNets()
+                    : _genGurobi();
+            phase.seconds.push_back(std::chrono::duration<double>(clock::now() - start).count());
+            if (!ok) {
+                LOG_ERROR("Benchmark phase " << phase.name << " failed\n");
+                return false;
+            }
+            phase.numCells = (p < 2) ? chip->libGateList().size() - numGatesBefore : chip->nodeList().size();
+            long peak = readPeakRssKB();
+            phase.peakRssKB = std::max(phase.peakRssKB, peakReset ? peak : peak - peakBefore);
+        }
+    }
+
+    std::ofstream outFile(outJson);
+    if (!outFile.is_open()) {
+        LOG_ERROR("Failed to open " << outJson << "\n");
+        return false;
+    }
+    outFile << "{\n  \"design\": \"" << inputDef << "\",\n  \"repeats\": " << repeats
+            << ",\n  \"peak_rss\": \"" << (peakReset ? "per phase" : "growth during phase")
+            << "\",\n  \"phases\": [\n";
+    for (size_t p = 0; p < phaseList.size(); ++p) {
+        const Phase& phase = phaseList[p];
+        double med = median(phase.seconds);
+        double mb = fileSizeMB(phase.inputName);
+        outFile << "    {\"name\": \"" << phase.name << "\""
+                << ", \"median_s\": " << med
+                << ", \"p95_s\": " << percentile(phase.seconds, 0.95)
+                << ", \"cells\": " << phase.numCells
+                << ", \"cells_per_s\": " << (med > 0 ? phase.numCells / med : 0)
+                << ", \"input_mb\": " << mb
+                << ", \"mb_per_s\": " << (med > 0 ? mb / med : 0)
+                << ", \"peak_rss_kb\": " << phase.peakRssKB << "}"
+                << (p + 1 < phaseList.size() ? ",\n" : "\n");
+    }
+    outFile << "  ]\n}\n";
+    outFile.close();
+
+    IOPkg benchMsg;
+    benchMsg << "Benchmark written to " << outJson << "\n";
+    return true;
+}
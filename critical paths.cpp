@@ -0,0 +1,186 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <queue>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include "legalizer/legalizer.h"
+#include "util/profiler.h"
+
+using namespace std;
+
+/*
+Top-K critical paths and per-logic slack histogram (NIMCH_paths.rpt)
+    Timing uses the same model as the Gurobi constraints, with every intNode
+    at its current libGate:
+        iAT[i] = max_{j in fanins(i)}{oAT[j] + delay(j, i)}     (c2)
+        oAT[i] = iAT[i] + delay(i, gate(i))                     (c3)
+    and the POs are required at maxDelay (c4).
+    Paths are enumerated backward from the POs by best-first search. A search
+    state is a path suffix (v, s): s is the delay from the output of v to the
+    PO. Its key oAT[v] + s is the length of the longest completion, so states
+    pop in order of their best path and completed paths come out longest
+    first. States keep a parent index, so the K paths share their suffixes
+    (each deviation costs one state, not a copy of the path).
+    slack[i] = reqOAT[i] - oAT[i]; the histogram bins slack in steps of
+    maxDelay / numBins, with one bin below 0 and one at >= maxDelay.
+*/
+
+bool Legalizer::reportCriticalPaths(std::string outputName, int numPaths, int numBins) {
+    PROFILE_SCOPE("reportCriticalPaths");
+    _writeLog("Enumerating the " + to_string(numPaths) + " most critical paths ...\n");
+
+    const auto& intNodeList = _chip->netlist->getIntNodeList();
+    const auto& poList = _chip->netlist->getPOList();
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
+    int numNodes = intNodeList.size();
+
+    // Fanin edges in CSR form (from the delay tables); source -1 is a PI whose
+    // arrival is folded into delay
+    if (!_buildFaninTable()) return false;
+    struct Edge {
+        int source;
+        double delay;
+    };
+    auto buildFanin = [&](const vector<int>& faninWire, vector<Edge>& edgeList) {
+        edgeList.reserve(faninWire.size());
+        for (int w : faninWire) {
+            edgeList.push_back({_wireSource[w], _wireArrival[w] + _wireDelay[w]});
+        }
+    };
+    const vector<int>& faninOffset = _faninOffset;
+    const vector<int>& poOffset = _poFaninOffset;
+    vector<Edge> faninList, poFaninList;
+    buildFanin(_faninWire, faninList);
+    buildFanin(_poFaninWire, poFaninList);
+    vector<double> nodeDelay(numNodes, 0.0);
+    for (int i=0; i<numNodes; ++i) {
+        int k = _libGateIndex(intNodeList[i], intNodeList[i]->getLibGate().get());
+        if (k != -1) nodeDelay[i] = _delayArena[_delayOffset[i] + k];
+    }
+
+    // Forward STA in the topological order of _buildFanoutTable
+    if (!_buildFanoutTable()) return false;
+    const vector<int>& topoOrder = _topoOrder;
+
+    vector<double> oAT(numNodes, 0.0), reqOAT(numNodes, INFINITY);
+    for (int i : topoOrder) {
+        double iAT = 0.0;
+        for (int f=faninOffset[i]; f<faninOffset[i + 1]; ++f) {
+            const Edge& e = faninList[f];
+            iAT = max(iAT, e.source == -1 ? e.delay : oAT[e.source] + e.delay);
+        }
+        oAT[i] = iAT + nodeDelay[i];
+    }
+    for (const Edge& e : poFaninList) {
+        if (e.source != -1) reqOAT[e.source] = min(reqOAT[e.source], maxDelay - e.delay);
+    }
+    for (auto it=topoOrder.rbegin(); it!=topoOrder.rend(); ++it) {
+        int i = *it;
+        double reqIAT = reqOAT[i] - nodeDelay[i];
+        for (int f=faninOffset[i]; f<faninOffset[i + 1]; ++f) {
+            const Edge& e = faninList[f];
+            if (e.source != -1) reqOAT[e.source] = min(reqOAT[e.source], reqIAT - e.delay);
+        }
+    }
+
+    // Best-first enumeration of the K longest PI-to-PO paths
+    struct State {
+        int node;       // intNode at the head of the suffix, -1 for a completed path
+        int parent;     // state of the next node toward the PO, -1 at the PO
+        int po;
+        int pi;         // fanin position of the PI in its sink's wire list
+        double suffix;  // delay from the output of node to the PO
+    };
+    vector<State> stateList;
+    using Entry = pair<double, int>;    // (path length bound, state)
+    priority_queue<Entry> heap;
+    auto pushState = [&](const State& state, double key) {
+        stateList.push_back(state);
+        heap.push({key, (int)stateList.size() - 1});
+    };
+    for (size_t p=0; p<poList.size(); ++p) {
+        for (int f=poOffset[p]; f<poOffset[p + 1]; ++f) {
+            const Edge& e = poFaninList[f];
+            if (e.source == -1) pushState({-1, -1, (int)p, f - poOffset[p], 0.0}, e.delay);
+            else pushState({e.source, -1, (int)p, -1, e.delay}, oAT[e.source] + e.delay);
+        }
+    }
+
+    vector<pair<double, int>> pathList;     // (length, completed state)
+    while (!heap.empty() && (int)pathList.size() < numPaths) {
+        Entry top = heap.top();
+        heap.pop();
+        State state = stateList[top.second];
+        if (state.node == -1) {
+            pathList.push_back(top);
+            continue;
+        }
+        int v = state.node;
+        double suffix = state.suffix + nodeDelay[v];
+        if (faninOffset[v] == faninOffset[v + 1]) {
+            pushState({-1, top.second, state.po, -1, suffix}, suffix);
+        }
+        for (int f=faninOffset[v]; f<faninOffset[v + 1]; ++f) {
+            const Edge& e = faninList[f];
+            if (e.source == -1) pushState({-1, top.second, state.po, f - faninOffset[v], suffix}, e.delay + suffix);
+            else pushState({e.source, top.second, state.po, -1, suffix + e.delay}, oAT[e.source] + suffix + e.delay);
+        }
+    }
+
+    ofstream outFile(outputName);
+    if (!outFile.is_open()) {
+        _writeErrorLog("Error: Failed to open " + outputName + "\n");
+        return false;
+    }
+    outFile << "# maxDelay " << maxDelay << ", " << numNodes << " intNodes, " << poList.size() << " POs\n";
+    outFile << "# " << pathList.size() << " most critical paths (PI -> ... -> PO)\n";
+    for (size_t k=0; k<pathList.size(); ++k) {
+        const State& done = stateList[pathList[k].second];
+        outFile << "path " << k << " length " << pathList[k].first << " slack " << maxDelay - pathList[k].first << "\n";
+        std::string piName = "-";
+        if (done.pi != -1) {
+            const auto& inWireList = (done.parent == -1) ? poList[done.po]->getInWireList()
+                                   : intNodeList[stateList[done.parent].node]->getInWireList();
+            piName = _chip->netlist->getWire(inWireList[done.pi])->getInNode()->getName();
+        }
+        outFile << "    " << piName;
+        for (int s=done.parent; s!=-1; s=stateList[s].parent) {
+            int v = stateList[s].node;
+            const LibGate* libGate = intNodeList[v]->getLibGate().get();
+            outFile << " -> " << intNodeList[v]->getName() << "(" << (libGate ? libGate->getName() : "-")
+                    << " @" << oAT[v] << ")";
+        }
+        outFile << " -> " << poList[done.po]->getName() << "\n";
+    }
+
+    // Slack histogram per logic
+    numBins = max(1, numBins);
+    double binWidth = maxDelay / numBins;
+    map<string, vector<size_t>> histogram;
+    for (int i=0; i<numNodes; ++i) {
+        vector<size_t>& bins = histogram[intNodeList[i]->getLogic()];
+        bins.resize(numBins + 2, 0);
+        double slack = reqOAT[i] - oAT[i];
+        int b = (slack < 0) ? 0 : (slack >= maxDelay || std::isinf(slack)) ? numBins + 1 : 1 + (int)(slack / binWidth);
+        ++bins[min(b, numBins + 1)];
+    }
+    outFile << "# slack histogram: logic <0";
+    for (int b=0; b<numBins; ++b) outFile << " [" << b * binWidth << "," << (b + 1) * binWidth << ")";
+    outFile << " >=" << maxDelay << "\n";
+    for (const auto& entry : histogram) {
+        outFile << "slack " << entry.first;
+        for (size_t count : entry.second) outFile << " " << count;
+        outFile << "\n";
+    }
+    outFile.close();
+
+    PROFILE_COUNT("criticalPaths/states", stateList.size());
+    double worst = pathList.empty() ? 0.0 : pathList[0].first;
+    _writeLog("Worst path " + to_string(worst) + " (slack " + to_string(maxDelay - worst) + "), report in "
+              + outputName + "\n");
+    _writeSuccessLog("Critical paths reported\n");
+    return true;
+}
@@ -0,0 +1,211 @@
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include "legalizer/legalizer.h"
+#include "util/profiler.h"
+
+using namespace std;
+
+/*
+Precomputed delay tables (integer-indexed, built once per design)
+    Gate delays
+        _delayArena[_delayOffset[i] + k] = delay(intNode i, libGate k)
+        k is the index of the gate in getLibGateList(logic(i)) (candidates:
+        _getCandidateGateIdx, any gate: _libGateIndex), so a node's delays
+        are one contiguous row of the arena
+    Wires
+        every wire that drives an intNode or a PO gets an integer ID w:
+            _wireDelay[w]     wire delay
+            _wireSource[w]    driving intNode index, -1 for a PI
+            _wireArrival[w]   PI oAT (0 for an intNode)
+        fanins of intNode i: _faninWire[_faninOffset[i] .. _faninOffset[i+1])
+        fanins of PO p:      _poFaninWire[_poFaninOffset[p] .. _poFaninOffset[p+1])
+    Fanouts (_buildFanoutTable), the transpose of the intNode fanins
+        fanouts of intNode i: o in [_fanoutOffset[i], _fanoutOffset[i+1]),
+        sink _fanoutNode[o] through wire _fanoutWire[o]
+        _topoOrder: intNodes in topological order
+        _nodeDepth[i]: number of intNodes on the longest path through i
+    The netlist's gate delay does not depend on the input pin, so the
+    [gate][fanin] table is stored as the [gate] row plus the per-wire delay;
+    delay(j -> i through k) = _wireDelay[w] + _delayArena[_delayOffset[i] + k].
+    Both tables replace the string-keyed getDelay/getWire lookups in the
+    per-node, per-gate, per-fanin loops of the generators and the STA.
+_clearDelayTables must be called when the design changes; it also drops the
+candidate gate caches (_getCandidateGates), which are keyed by node name.
+*/
+
+void Legalizer::_buildGateDelayTable() {
+    if (!_delayOffset.empty()) return;
+    PROFILE_SCOPE("buildGateDelayTable");
+    const auto& intNodeList = _chip->netlist->getIntNodeList();
+    size_t numNodes = intNodeList.size();
+
+    _intNodeIdx.clear();
+    _intNodeIdx.reserve(numNodes);
+    _delayOffset.assign(numNodes + 1, 0);
+    for (size_t i=0; i<numNodes; ++i) {
+        _intNodeIdx[intNodeList[i]->getName()] = i;
+        _delayOffset[i + 1] = _delayOffset[i] + _gateLibrary->getLibGateList(intNodeList[i]->getLogic()).size();
+    }
+    _delayArena.resize(_delayOffset[numNodes]);
+    for (size_t i=0; i<numNodes; ++i) {
+        const sPtr<IntNode>& intNode = intNodeList[i];
+        const auto& libGateList = _gateLibrary->getLibGateList(intNode->getLogic());
+        double* row = _delayArena.data() + _delayOffset[i];
+        for (size_t k=0; k<libGateList.size(); ++k) {
+            row[k] = intNode->getDelay(libGateList[k]->getName());
+        } // for each libGate whose logic matches intNode
+    } // for each intNode
+    PROFILE_COUNT("delayTable/entries", _delayArena.size());
+}
+
+bool Legalizer::_buildFaninTable() {
+    if (!_faninOffset.empty()) return true;
+    _buildGateDelayTable();
+    PROFILE_SCOPE("buildFaninTable");
+    const auto& intNodeList = _chip->netlist->getIntNodeList();
+    const auto& poList = _chip->netlist->getPOList();
+
+    unordered_map<string, int> wireIdx;
+    auto addFanins = [&](const vector<std::string>& inWireList, vector<int>& faninWire) -> bool {
+        for (const std::string& iWireName : inWireList) {
+            auto it = wireIdx.find(iWireName);
+            if (it == wireIdx.end()) {
+                sPtr<Wire> wire = _chip->netlist->getWire(iWireName);
+                sPtr<Node> iNode = wire->getInNode();
+                if (iNode->isInternal()) {
+                    _wireSource.push_back(_intNodeIdx.at(iNode->getName()));
+                    _wireArrival.push_back(0.0);
+                }
+                else if (iNode->isPI()) {
+                    _wireSource.push_back(-1);
+                    _wireArrival.push_back(_chip->netlist->getPI(iNode->getName())->getOAT());
+                }
+                else {
+                    return false;
+                }
+                _wireDelay.push_back(wire->getDelay());
+                it = wireIdx.emplace(iWireName, _wireDelay.size() - 1).first;
+            }
+            faninWire.push_back(it->second);
+        }
+        return true;
+    };
+
+    vector<int> faninOffset(intNodeList.size() + 1, 0);
+    vector<int> poFaninOffset(poList.size() + 1, 0);
+    bool ok = true;
+    for (size_t i=0; ok && i<intNodeList.size(); ++i) {
+        ok = addFanins(intNodeList[i]->getInWireList(), _faninWire);
+        faninOffset[i + 1] = _faninWire.size();
+    }
+    for (size_t p=0; ok && p<poList.size(); ++p) {
+        ok = addFanins(poList[p]->getInWireList(), _poFaninWire);
+        poFaninOffset[p + 1] = _poFaninWire.size();
+    }
+    if (!ok) {
+        _clearDelayTables();
+        _writeErrorLog("Error: iNode is neither internal nor PI!\n");
+        return false;
+    }
+    _faninOffset.swap(faninOffset);
+    _poFaninOffset.swap(poFaninOffset);
+    PROFILE_COUNT("delayTable/wires", _wireDelay.size());
+    return true;
+}
+
+int Legalizer::_libGateIndex(const sPtr<IntNode>& intNode, const LibGate* libGate) {
+    const auto& libGateList = _gateLibrary->getLibGateList(intNode->getLogic());
+    for (size_t k=0; k<libGateList.size(); ++k) {
+        if (libGateList[k].get() == libGate) return k;
+    }
+    return -1;
+}
+
+bool Legalizer::_buildFanoutTable() {
+    if (!_topoOrder.empty()) return true;
+    if (!_buildFaninTable()) return false;
+    PROFILE_SCOPE("buildFanoutTable");
+    int numNodes = _faninOffset.size() - 1;
+
+    vector<int> fanoutOffset(numNodes + 1, 0), numPending(numNodes, 0);
+    for (int i=0; i<numNodes; ++i) {
+        for (int f=_faninOffset[i]; f<_faninOffset[i + 1]; ++f) {
+            int j = _wireSource[_faninWire[f]];
+            if (j != -1) {
+                ++fanoutOffset[j + 1];
+                ++numPending[i];
+            }
+        }
+    }
+    for (int i=0; i<numNodes; ++i) fanoutOffset[i + 1] += fanoutOffset[i];
+    vector<int> fanoutNode(fanoutOffset[numNodes]), fanoutWire(fanoutOffset[numNodes]);
+    {
+        vector<int> fill(fanoutOffset.begin(), fanoutOffset.end() - 1);
+        for (int i=0; i<numNodes; ++i) {
+            for (int f=_faninOffset[i]; f<_faninOffset[i + 1]; ++f) {
+                int j = _wireSource[_faninWire[f]];
+                if (j != -1) {
+                    fanoutNode[fill[j]] = i;
+                    fanoutWire[fill[j]++] = _faninWire[f];
+                }
+            }
+        }
+    }
+
+    vector<int> topoOrder;
+    topoOrder.reserve(numNodes);
+    for (int i=0; i<numNodes; ++i) if (numPending[i] == 0) topoOrder.push_back(i);
+    for (size_t t=0; t<topoOrder.size(); ++t) {
+        int i = topoOrder[t];
+        for (int o=fanoutOffset[i]; o<fanoutOffset[i + 1]; ++o) {
+            if (--numPending[fanoutNode[o]] == 0) topoOrder.push_back(fanoutNode[o]);
+        }
+    }
+    if ((int)topoOrder.size() != numNodes) {
+        _writeErrorLog("Error: the netlist has a combinational loop!\n");
+        return false;
+    }
+
+    vector<int> depthIn(numNodes, 1), depthOut(numNodes, 1), depth(numNodes, 1);
+    for (int i : topoOrder) {
+        for (int f=_faninOffset[i]; f<_faninOffset[i + 1]; ++f) {
+            int j = _wireSource[_faninWire[f]];
+            if (j != -1) depthIn[i] = max(depthIn[i], depthIn[j] + 1);
+        }
+    }
+    for (auto it=topoOrder.rbegin(); it!=topoOrder.rend(); ++it) {
+        for (int o=fanoutOffset[*it]; o<fanoutOffset[*it + 1]; ++o) {
+            depthOut[*it] = max(depthOut[*it], depthOut[fanoutNode[o]] + 1);
+        }
+        depth[*it] = depthIn[*it] + depthOut[*it] - 1;
+    }
+
+    _fanoutOffset.swap(fanoutOffset);
+    _fanoutNode.swap(fanoutNode);
+    _fanoutWire.swap(fanoutWire);
+    _topoOrder.swap(topoOrder);
+    _nodeDepth.swap(depth);
+    return true;
+}
+
+void Legalizer::_clearDelayTables() {
+    _intNodeIdx.clear();
+    _delayOffset.clear();
+    _delayArena.clear();
+    _wireDelay.clear();
+    _wireSource.clear();
+    _wireArrival.clear();
+    _faninOffset.clear();
+    _faninWire.clear();
+    _poFaninOffset.clear();
+    _poFaninWire.clear();
+    _fanoutOffset.clear();
+    _fanoutNode.clear();
+    _fanoutWire.clear();
+    _topoOrder.clear();
+    _nodeDepth.clear();
+    _candidateGateList.clear();
+    _candidateGateIdxList.clear();
+}
@@ -0,0 +1,82 @@
+#include <vector>
+#include <string>
+#include "legalizer/legalizer.h"
+
+using namespace std;
+
+/*
+Candidate gates of an intNode with dominated drive-strength variants removed
+    Within one (logic, height) group, gate d dominates gate k when
+        - width(d) == width(k)  (c5 has a lower bound gamma*W_chip, so a narrower
+                                 gate is not always at least as good)
+        - area(d) <= area(k)
+        - delay(i, d) <= delay(i, k)
+    with ties broken by library order so exactly one of two identical gates
+    survives. Replacing k by d in any feasible solution keeps c1-c5 satisfied
+    and does not increase the area or height-mismatch objective, so the pruned
+    model has the same optimum.
+The geometric part (height, width, area) depends only on the library and is
+computed once per logic; delay(i, k) is per intNode, so the final check is
+done per node (from the delay table) and cached by node name, both as gates
+and as their indices into getLibGateList(logic) (_getCandidateGateIdx), which
+index the node's row of the delay table.
+*/
+
+void Legalizer::_buildGateDominance(const vector<sPtr<LibGate>>& libGateList) {
+    for (size_t k=0; k<libGateList.size(); ++k) {
+        const sPtr<LibGate>& gate = libGateList[k];
+        vector<int>& dominatorList = _gateDominatorList[gate->getName()];
+        dominatorList.clear();
+        for (size_t d=0; d<libGateList.size(); ++d) {
+            const sPtr<LibGate>& other = libGateList[d];
+            if (d == k || other->getHeight() != gate->getHeight()) continue;
+            if (other->getBoundary().width() != gate->getBoundary().width()) continue;
+            if (other->getBoundary().area() > gate->getBoundary().area()) continue;
+            dominatorList.push_back(d);
+        } // for each other libGate of the same logic
+    } // for each libGate of the logic
+}
+
+const vector<sPtr<LibGate>>& Legalizer::_getCandidateGates(const sPtr<IntNode>& intNode) {
+    auto cacheIt = _candidateGateList.find(intNode->getName());
+    if (cacheIt != _candidateGateList.end()) {
+        return cacheIt->second;
+    }
+
+    const auto& libGateList = _gateLibrary->getLibGateList(intNode->getLogic());
+    if (!libGateList.empty() && _gateDominatorList.find(libGateList[0]->getName()) == _gateDominatorList.end()) {
+        _buildGateDominance(libGateList);
+    }
+
+    _buildGateDelayTable();
+    const double* delay = _delayArena.data() + _delayOffset[_intNodeIdx.at(intNode->getName())];
+
+    vector<sPtr<LibGate>>& candidateList = _candidateGateList[intNode->getName()];
+    vector<int>& candidateIdxList = _candidateGateIdxList[intNode->getName()];
+    for (size_t k=0; k<libGateList.size(); ++k) {
+        const auto& area = [&](size_t g) { return libGateList[g]->getBoundary().area(); };
+        bool dominated = false;
+        for (int d : _gateDominatorList.at(libGateList[k]->getName())) {
+            if (delay[d] > delay[k]) continue;
+            bool strictlyBetter = delay[d] < delay[k] || area(d) < area(k);
+            if (strictlyBetter || (size_t)d < k) {
+                dominated = true;
+                break;
+            }
+        } // for each geometric dominator of libGate k
+        if (!dominated) {
+            candidateList.push_back(libGateList[k]);
+            candidateIdxList.push_back(k);
+        }
+    } // for each libGate whose logic matches intNode
+    return candidateList;
+}
+
+const vector<int>& Legalizer::_getCandidateGateIdx(const sPtr<IntNode>& intNode) {
+    auto cacheIt = _candidateGateIdxList.find(intNode->getName());
+    if (cacheIt != _candidateGateIdxList.end()) {
+        return cacheIt->second;
+    }
+    _getCandidateGates(intNode);
+    return _candidateGateIdxList.at(intNode->getName());
+}
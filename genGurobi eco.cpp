@@ -0,0 +1,433 @@
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <unordered_map>
+#include "legalizer/legalizer.h"
+#include "util/profiler.h"
+
+using namespace std;
+
+/*
+ECO mode: re-legalize a DEF that differs from the previous run in a few cells
+    Every _genGurobi / _genGurobiEco run stores a snapshot of its input
+    (NIMCH_eco_snapshot.txt: <component> <x> <y> <macro>) next to the
+    solver's NIMCH_gurobi_result.txt. The snapshot is written as
+    <snapshot>.pending and only replaces the previous one once
+    parseGurobiResult has applied a result, so a failed or abandoned solve
+    keeps the snapshot that matches the last result. On the next run an
+    intNode is changed
+    when it is new, moved, or its macro differs from both the snapshot macro
+    and the gate the previous run chose for it. Every other node keeps its
+    previous gate.
+    Only changed nodes get x[i][k] variables. The subproblem contains:
+        - (c1, c3) for changed nodes
+        - (c2) for their fanins, fixed fanins contribute their STA arrival time
+        - (c4) a required-time budget from STA on every fanout edge that leaves
+          the changed set, which stands in for the fixed fanout cone
+        - (c5) only the row windows that contain a changed node or the
+          snapshot row of a moved or deleted node, with the width of fixed
+          nodes folded into the bounds
+    The model size therefore follows the size of the change; the tables and
+    the STA pass stay linear in the design.
+    The c4 budgets of changed nodes are computed independently, so two
+    changed nodes on one path can spend the same slack. The solver reruns
+    STA on the final assignment and keeps the input gates of the changed
+    nodes when the result breaks maxDelay.
+
+_genGurobiEco writes the tables (see _writeGurobiTables) followed by one
+line with the fixed candidate index of every node (-1: changed) and one
+line with the snapshot rows of moved or deleted nodes (<count> <row> ...)
+to NIMCH_gurobi_eco.txt, and a fixed solver program to
+NIMCH_gurobi_eco_c++.cpp. The snapshot stores each node's row.
+*/
+
+static const char* ecoSolverSource = R"(/*
+ * This file is generated by NIMCHLegalizer (ECO mode)
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gurobi_c++.h"
+using namespace std;
+
+struct Gate { string name; int height; double width, area; };
+struct Edge { int node; double delay; };    // node == -1: delay is an absolute arrival time
+struct Node {
+    string name;
+    int row, choice;
+    vector<int> gate;
+    vector<double> delay;
+    vector<Edge> fanin, fanout;             // fanout.node == -1: PO
+};
+
+int main() {
+    try {
+        ifstream inFile("NIMCH_gurobi_eco.txt");
+        if (!inFile.is_open()) {
+            cerr << "Error: Failed to open NIMCH_gurobi_eco.txt" << endl;
+            return 1;
+        }
+        string tag;
+        int version, numRows, numGates, numNodes, numPOs;
+        double chipWidth, gamma, maxDelay;
+        inFile >> tag >> version >> numRows >> chipWidth >> gamma >> maxDelay;
+        vector<int> rowHeight(numRows);
+        for (int& h : rowHeight) inFile >> h;
+        inFile >> numGates;
+        vector<Gate> gateList(numGates);
+        for (Gate& g : gateList) inFile >> g.name >> g.height >> g.width >> g.area;
+        inFile >> numNodes;
+        vector<Node> nodeList(numNodes);
+        for (Node& n : nodeList) {
+            int numCand, numFanin;
+            inFile >> n.name >> n.row >> n.choice >> numCand;
+            n.gate.resize(numCand);
+            n.delay.resize(numCand);
+            for (int k = 0; k < numCand; ++k) inFile >> n.gate[k] >> n.delay[k];
+            inFile >> numFanin;
+            n.fanin.resize(numFanin);
+            for (Edge& e : n.fanin) inFile >> e.node >> e.delay;
+        }
+        inFile >> numPOs;
+        for (int p = 0; p < numPOs; ++p) {
+            int numFanin;
+            inFile >> numFanin;
+            for (int f = 0; f < numFanin; ++f) {
+                Edge e;
+                inFile >> e.node >> e.delay;
+                if (e.node != -1) nodeList[e.node].fanout.push_back({-1, e.delay});
+            }
+        }
+        // Fixed choice per node; changed nodes start from their input gate
+        vector<int> freeList, local(numNodes, -1);
+        for (int i = 0; i < numNodes; ++i) {
+            int fixed;
+            inFile >> fixed;
+            if (fixed == -1) {
+                local[i] = freeList.size();
+                freeList.push_back(i);
+            }
+            else nodeList[i].choice = fixed;
+        }
+        // Rows vacated by nodes that moved away or were deleted
+        int numVacated = 0;
+        vector<int> vacatedRowList;
+        if (inFile >> numVacated) vacatedRowList.resize(numVacated);
+        for (int& r : vacatedRowList) inFile >> r;
+        inFile.close();
+
+        // STA on the current assignment
+        vector<int> numPending(numNodes, 0), topoOrder;
+        for (int i = 0; i < numNodes; ++i) {
+            for (const Edge& e : nodeList[i].fanin) {
+                if (e.node != -1) {
+                    nodeList[e.node].fanout.push_back({i, e.delay});
+                    ++numPending[i];
+                }
+            }
+        }
+        for (int i = 0; i < numNodes; ++i) if (numPending[i] == 0) topoOrder.push_back(i);
+        for (size_t t = 0; t < topoOrder.size(); ++t) {
+            for (const Edge& e : nodeList[topoOrder[t]].fanout) {
+                if (e.node != -1 && --numPending[e.node] == 0) topoOrder.push_back(e.node);
+            }
+        }
+        vector<double> oAT(numNodes, 0), reqOAT(numNodes, INFINITY);
+        for (int i : topoOrder) {
+            const Node& n = nodeList[i];
+            double iAT = 0;
+            for (const Edge& e : n.fanin) iAT = max(iAT, e.node == -1 ? e.delay : oAT[e.node] + e.delay);
+            oAT[i] = iAT + n.delay[n.choice];
+        }
+        auto worstArrival = [&]() {
+            vector<double> at(numNodes, 0);
+            double worst = 0;
+            for (int i : topoOrder) {
+                const Node& n = nodeList[i];
+                double iAT = 0;
+                for (const Edge& e : n.fanin) iAT = max(iAT, e.node == -1 ? e.delay : at[e.node] + e.delay);
+                at[i] = iAT + n.delay[n.choice];
+                for (const Edge& e : n.fanout) {
+                    if (e.node == -1) worst = max(worst, at[i] + e.delay);
+                }
+            }
+            return worst;
+        };
+        const double timingTol = 1e-6;
+        double inputWorst = worstArrival();
+        for (auto it = topoOrder.rbegin(); it != topoOrder.rend(); ++it) {
+            const Node& n = nodeList[*it];
+            double req = INFINITY;
+            for (const Edge& e : n.fanout) {
+                double reqIAT = (e.node == -1) ? maxDelay
+                    : reqOAT[e.node] - nodeList[e.node].delay[nodeList[e.node].choice];
+                req = min(req, reqIAT - e.delay);
+            }
+            reqOAT[*it] = req;
+        }
+
+        ofstream outFile("NIMCH_gurobi_result.txt");
+        cout << "ECO: " << freeList.size() << " of " << numNodes << " nodes changed" << endl;
+
+        if (!freeList.empty()) {
+            GRBEnv env = GRBEnv(true);
+            env.set("LogFile", "NIMCH_gurobi.log");
+            env.start();
+            GRBModel model = GRBModel(env);
+
+            size_t numFree = freeList.size();
+            vector<vector<GRBVar>> x(numFree);
+            vector<GRBVar> iAT(numFree), oATVar(numFree);
+            GRBLinExpr areaSum = 0;
+            for (size_t b = 0; b < numFree; ++b) {
+                const Node& n = nodeList[freeList[b]];
+                GRBLinExpr xSum = 0, delaySum = 0;
+                for (size_t k = 0; k < n.gate.size(); ++k) {
+                    x[b].push_back(model.addVar(0.0, 1.0, 0.0, GRB_BINARY,
+                                                "x[" + n.name + "][" + gateList[n.gate[k]].name + "]"));
+                    x[b][k].set(GRB_DoubleAttr_Start, (int)k == n.choice ? 1.0 : 0.0);
+                    xSum += x[b][k];
+                    delaySum += x[b][k] * n.delay[k];
+                    areaSum += x[b][k] * gateList[n.gate[k]].area;
+                }
+                iAT[b] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, "iAT[" + n.name + "]");
+                oATVar[b] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, "oAT[" + n.name + "]");
+                model.addConstr(xSum == 1, "c1[" + n.name + "]");
+                model.addConstr(oATVar[b] == iAT[b] + delaySum, "c3[" + n.name + "]");
+            }
+            for (size_t b = 0; b < numFree; ++b) {
+                const Node& n = nodeList[freeList[b]];
+                for (const Edge& e : n.fanin) {                             // (c2)
+                    if (e.node != -1 && local[e.node] != -1) model.addConstr(iAT[b] >= oATVar[local[e.node]] + e.delay);
+                    else model.addConstr(iAT[b] >= (e.node == -1 ? e.delay : oAT[e.node] + e.delay));
+                }
+                double budget = INFINITY;
+                for (const Edge& e : n.fanout) {                            // (c4) budgeted
+                    if (e.node == -1) budget = min(budget, maxDelay - e.delay);
+                    else if (local[e.node] == -1) {
+                        const Node& m = nodeList[e.node];
+                        budget = min(budget, reqOAT[e.node] - m.delay[m.choice] - e.delay);
+                    }
+                }
+                if (budget < INFINITY) model.addConstr(oATVar[b] <= budget, "c4[" + n.name + "]");
+            }
+
+            // (c5) only the windows that contain a changed node or a vacated row
+            vector<char> affected(numRows, 0);
+            auto markWindows = [&](int row) {
+                for (int r = max(0, row - 1); r <= min(numRows - 1, row + 1); ++r) affected[r] = 1;
+            };
+            for (int i : freeList) markWindows(nodeList[i].row);
+            for (int row : vacatedRowList) markWindows(row);
+            unordered_map<int, GRBLinExpr> widthSum;
+            unordered_map<int, double> fixedWidth;
+            for (int i = 0; i < numNodes; ++i) {
+                const Node& n = nodeList[i];
+                for (int r = max(0, n.row - 1); r <= min(numRows - 1, n.row + 1); ++r) {
+                    if (!affected[r]) continue;
+                    if (local[i] != -1) {
+                        for (size_t k = 0; k < n.gate.size(); ++k) {
+                            const Gate& g = gateList[n.gate[k]];
+                            if (g.height == rowHeight[r]) widthSum[r] += x[local[i]][k] * g.width;
+                        }
+                    }
+                    else {
+                        const Gate& g = gateList[n.gate[n.choice]];
+                        if (g.height == rowHeight[r]) fixedWidth[r] += g.width;
+                    }
+                }
+            }
+            for (int r = 0; r < numRows; ++r) {
+                if (!affected[r]) continue;
+                model.addConstr(widthSum[r] + fixedWidth[r] >= gamma * chipWidth, "c5[" + to_string(r) + "][lower]");
+                model.addConstr(widthSum[r] + fixedWidth[r] <= chipWidth, "c5[" + to_string(r) + "][upper]");
+            }
+
+            model.setObjective(areaSum, GRB_MINIMIZE);
+            model.optimize();
+
+            if (model.get(GRB_IntAttr_SolCount) > 0) {
+                vector<int> inputChoice(numFree);
+                for (size_t b = 0; b < numFree; ++b) {
+                    inputChoice[b] = nodeList[freeList[b]].choice;
+                    for (size_t k = 0; k < x[b].size(); ++k) {
+                        if (x[b][k].get(GRB_DoubleAttr_X) > 0.5) {
+                            nodeList[freeList[b]].choice = k;
+                            break;
+                        }
+                    }
+                }
+                // The budgets may have spent one path's slack twice
+                double worst = worstArrival();
+                if (worst > max(maxDelay, inputWorst) + timingTol) {
+                    cerr << "ECO: the assignment reaches " << worst << " > maxDelay " << maxDelay
+                         << ", keeping the input gates of the changed nodes" << endl;
+                    for (size_t b = 0; b < numFree; ++b) nodeList[freeList[b]].choice = inputChoice[b];
+                }
+            }
+            else {
+                cerr << "ECO: no feasible assignment for the changed nodes, keeping their input gates" << endl;
+            }
+        }
+
+        // Output Results
+        for (const Node& n : nodeList) {
+            outFile << n.name << " " << gateList[n.gate[n.choice]].name << "\n";
+        }
+        outFile.close();
+
+    } catch (GRBException e) {
+        cerr << "Error code = " << e.getErrorCode() << endl;
+        cerr << e.getMessage() << endl;
+    } catch (...) {
+        cerr << "Exception during optimization" << endl;
+    }
+
+    return 0;
+}
+)";
+
+bool Legalizer::_writeEcoSnapshot(std::string snapshotName) {
+    std::string pendingName = snapshotName + ".pending";
+    ofstream snapshotFile(pendingName);
+    if (!snapshotFile.is_open()) {
+        _writeErrorLog("Error: Failed to open " + pendingName + "\n");
+        return false;
+    }
+    for (const sPtr<IntNode>& intNode : _chip->netlist->getIntNodeList()) {
+        const LibGate* libGate = intNode->getLibGate().get();
+        snapshotFile << intNode->getName() << " " << intNode->getBoundary().x1() << " "
+                     << intNode->getBoundary().y1() << " " << (libGate ? libGate->getName() : "-") << " "
+                     << intNode->getRow() << "\n";
+    }
+    snapshotFile.close();
+    _pendingEcoSnapshot = snapshotName;
+    return true;
+}
+
+// Called once a result has been applied; the pending snapshot becomes the
+// reference of the next ECO run
+bool Legalizer::_promoteEcoSnapshot() {
+    if (_pendingEcoSnapshot.empty()) return true;
+    std::string pendingName = _pendingEcoSnapshot + ".pending";
+    if (rename(pendingName.c_str(), _pendingEcoSnapshot.c_str()) != 0) {
+        _writeErrorLog("Error: Failed to rename " + pendingName + " to " + _pendingEcoSnapshot + "\n");
+        return false;
+    }
+    _pendingEcoSnapshot.clear();
+    return true;
+}
+
+bool Legalizer::_genGurobiEco(std::string snapshotName, std::string prevResultName) {
+    PROFILE_SCOPE("genGurobiEco");
+    _writeLog("Generating the ECO Gurobi model ...\n");
+
+    struct SnapshotEntry {
+        double x, y;
+        std::string macro;
+        int row;
+        bool present;
+    };
+    unordered_map<string, SnapshotEntry> snapshot;
+    ifstream snapshotFile(snapshotName);
+    if (!snapshotFile.is_open()) {
+        _writeErrorLog("Error: No snapshot " + snapshotName + " from a previous run, run _genGurobi first\n");
+        return false;
+    }
+    std::string line, name, macro;
+    double x, y;
+    while (getline(snapshotFile, line)) {
+        istringstream fields(line);
+        int row = -1;
+        if (!(fields >> name >> x >> y >> macro)) continue;
+        fields >> row;      // absent in snapshots of older runs
+        snapshot[name] = {x, y, macro, row, false};
+    }
+    snapshotFile.close();
+
+    unordered_map<string, string> prevChoice;
+    ifstream prevResultFile(prevResultName);
+    std::string gateName;
+    while (prevResultFile >> name >> gateName) {
+        prevChoice[name] = gateName;
+    }
+
+    ofstream outFile("NIMCH_gurobi_eco_c++.cpp");
+    if (!outFile.is_open()) {
+        cerr << "Error: Failed to open output file!" << endl;
+        return false;
+    }
+    outFile << ecoSolverSource;
+    outFile.close();
+
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
+    int numRows = _chip->getNumRows();
+    double chipWidth = _chip->getBoundary().width();
+    const double gamma = _gamma;
+
+    // Fixed candidate index per node, -1 for changed nodes
+    const auto& intNodeList = _chip->netlist->getIntNodeList();
+    size_t numChanged = 0;
+    std::string fixedLine;
+    vector<int> vacatedRowList;
+    for (size_t i=0; i<intNodeList.size(); ++i) {
+        const sPtr<IntNode>& intNode = intNodeList[i];
+        int fixed = -1;
+        bool moved = false;
+        auto snapIt = snapshot.find(intNode->getName());
+        if (snapIt != snapshot.end()) {
+            SnapshotEntry& entry = snapIt->second;
+            entry.present = true;
+            moved = entry.x != intNode->getBoundary().x1() || entry.y != intNode->getBoundary().y1();
+            if (moved && entry.row != -1) vacatedRowList.push_back(entry.row);
+        }
+        auto choiceIt = prevChoice.find(intNode->getName());
+        if (snapIt != snapshot.end() && choiceIt != prevChoice.end()) {
+            const SnapshotEntry& entry = snapIt->second;
+            std::string curMacro = intNode->getLibGate() ? intNode->getLibGate()->getName() : "-";
+            bool resized = curMacro != entry.macro && curMacro != choiceIt->second;
+            if (!moved && !resized) {
+                const auto& gateList = _getCandidateGates(intNode);
+                for (size_t k=0; k<gateList.size(); ++k) {
+                    if (gateList[k]->getName() == choiceIt->second) {
+                        fixed = k;
+                        break;
+                    }
+                }
+            }
+        }
+        if (fixed == -1) ++numChanged;
+        fixedLine += to_string(fixed) + (i+1 == intNodeList.size() ? "\n" : " ");
+    }
+    // Deleted nodes leave their snapshot row too
+    for (const auto& [snapName, entry] : snapshot) {
+        if (!entry.present && entry.row != -1) vacatedRowList.push_back(entry.row);
+    }
+    fixedLine += to_string(vacatedRowList.size());
+    for (int row : vacatedRowList) {
+        fixedLine += " " + to_string(row);
+    }
+    fixedLine += "\n";
+
+    ostringstream header;
+    header.precision(10);
+    header << "NIMCH_ECO 1 " << numRows << " " << chipWidth << " " << gamma << " " << maxDelay << "\n";
+    if (!_writeGurobiTables("NIMCH_gurobi_eco.txt", header.str(), fixedLine)) return false;
+    PROFILE_COUNT("eco/changedNodes", numChanged);
+
+    if (!_writeEcoSnapshot(snapshotName)) return false;
+
+    _writeLog("ECO: " + to_string(numChanged) + " of " + to_string(intNodeList.size())
+              + " intNodes changed since the previous run\n");
+    _writeSuccessLog("ECO Gurobi model generated\n");
+    return true;
+}
@@ -0,0 +1,356 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include "legalizer/legalizer.h"
+#include "util/profiler.h"
+
+using namespace std;
+
+/*
+Lazy timing constraints (cutting planes driven by native STA)
+    The model starts with c1, c5 and the objective only. Timing rows are
+    added per path: for a PI-to-PO path, every node on it gets iAT/oAT and
+    its c3 row, every edge on it a c2 row, and the PO its c4 row. Nodes and
+    edges shared by several paths are added once.
+        - initial rows: the worst path into each PO whose slack under the
+          input gate assignment is below margin * maxDelay
+        - each round: solve, propagate arrival times natively for the
+          incumbent, and add the worst path into every PO that misses
+          maxDelay; stop when none does (or after maxRounds)
+    Every added row is implied by the full model, so the final assignment is
+    feasible and optimal for it; only the rows that constrain it are built.
+    Each c2/c3 row on a path may be off by Gurobi's default FeasibilityTol
+    (1e-6), so arrival times are checked against maxDelay with that
+    tolerance times the rows of the longest path, scaled by maxDelay. A PO
+    that still misses maxDelay when its worst path is fully in the model
+    only misses it by solver tolerances, and the result is kept.
+    Without a feasible assignment the program writes no result file and
+    still exits 0.
+
+_genGurobiLazy writes the tables (see _writeGurobiTables) to
+NIMCH_gurobi_lazy.txt and a fixed solver program to
+NIMCH_gurobi_lazy_c++.cpp.
+*/
+
+static const char* lazySolverSource = R"(/*
+ * This file is generated by NIMCHLegalizer (lazy timing constraints)
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gurobi_c++.h"
+using namespace std;
+
+struct Gate { string name; int height; double width, area; };
+struct Edge { int node; double delay; };    // node == -1: delay is an absolute arrival time
+struct Node {
+    string name;
+    int row, choice;
+    vector<int> gate;
+    vector<double> delay;
+    vector<Edge> fanin, fanout;
+};
+
+int numNodes;
+vector<Node> nodeList;
+vector<vector<Edge>> poFanin;
+vector<int> topoOrder;
+vector<double> oAT;
+
+// Arrival times for the current choices
+void sta() {
+    for (int i : topoOrder) {
+        const Node& n = nodeList[i];
+        double iAT = 0;
+        for (const Edge& e : n.fanin) iAT = max(iAT, e.node == -1 ? e.delay : oAT[e.node] + e.delay);
+        oAT[i] = iAT + n.delay[n.choice];
+    }
+}
+
+double poArrival(int p, int& worstFanin) {
+    double iAT = 0;
+    worstFanin = -1;
+    for (size_t f = 0; f < poFanin[p].size(); ++f) {
+        const Edge& e = poFanin[p][f];
+        double at = e.node == -1 ? e.delay : oAT[e.node] + e.delay;
+        if (worstFanin == -1 || at > iAT) {
+            iAT = at;
+            worstFanin = f;
+        }
+    }
+    return iAT;
+}
+
+int main() {
+    try {
+        ifstream inFile("NIMCH_gurobi_lazy.txt");
+        if (!inFile.is_open()) {
+            cerr << "Error: Failed to open NIMCH_gurobi_lazy.txt" << endl;
+            return 1;
+        }
+        string tag;
+        int version, numRows, numGates, numPOs, maxRounds;
+        double chipWidth, gamma, maxDelay, margin;
+        inFile >> tag >> version >> numRows >> chipWidth >> gamma >> maxDelay >> margin >> maxRounds;
+        vector<int> rowHeight(numRows);
+        for (int& h : rowHeight) inFile >> h;
+        inFile >> numGates;
+        vector<Gate> gateList(numGates);
+        for (Gate& g : gateList) inFile >> g.name >> g.height >> g.width >> g.area;
+        inFile >> numNodes;
+        nodeList.resize(numNodes);
+        for (Node& n : nodeList) {
+            int numCand, numFanin;
+            inFile >> n.name >> n.row >> n.choice >> numCand;
+            n.gate.resize(numCand);
+            n.delay.resize(numCand);
+            for (int k = 0; k < numCand; ++k) inFile >> n.gate[k] >> n.delay[k];
+            inFile >> numFanin;
+            n.fanin.resize(numFanin);
+            for (Edge& e : n.fanin) inFile >> e.node >> e.delay;
+        }
+        inFile >> numPOs;
+        poFanin.resize(numPOs);
+        for (vector<Edge>& fanin : poFanin) {
+            int numFanin;
+            inFile >> numFanin;
+            fanin.resize(numFanin);
+            for (Edge& e : fanin) inFile >> e.node >> e.delay;
+        }
+        inFile.close();
+
+        vector<int> numPending(numNodes, 0);
+        for (int i = 0; i < numNodes; ++i) {
+            for (const Edge& e : nodeList[i].fanin) {
+                if (e.node != -1) {
+                    nodeList[e.node].fanout.push_back({i, e.delay});
+                    ++numPending[i];
+                }
+            }
+        }
+        for (int i = 0; i < numNodes; ++i) if (numPending[i] == 0) topoOrder.push_back(i);
+        for (size_t t = 0; t < topoOrder.size(); ++t) {
+            for (const Edge& e : nodeList[topoOrder[t]].fanout) {
+                if (--numPending[e.node] == 0) topoOrder.push_back(e.node);
+            }
+        }
+        oAT.assign(numNodes, 0);
+
+        GRBEnv env = GRBEnv(true);
+        env.set("LogFile", "NIMCH_gurobi.log");
+        env.start();
+        GRBModel model = GRBModel(env);
+
+        // (v1) x[i][k], (c1), objective
+        vector<vector<GRBVar>> x(numNodes);
+        GRBLinExpr areaSum = 0;
+        for (int i = 0; i < numNodes; ++i) {
+            const Node& n = nodeList[i];
+            GRBLinExpr xSum = 0;
+            for (size_t k = 0; k < n.gate.size(); ++k) {
+                x[i].push_back(model.addVar(0.0, 1.0, 0.0, GRB_BINARY,
+                                            "x[" + n.name + "][" + gateList[n.gate[k]].name + "]"));
+                xSum += x[i][k];
+                areaSum += x[i][k] * gateList[n.gate[k]].area;
+            }
+            model.addConstr(xSum == 1, "c1[" + n.name + "]");
+        }
+
+        // (c5)
+        vector<GRBLinExpr> widthSum(numRows, 0);
+        for (int i = 0; i < numNodes; ++i) {
+            const Node& n = nodeList[i];
+            for (int r = max(0, n.row - 1); r <= min(numRows - 1, n.row + 1); ++r) {
+                for (size_t k = 0; k < n.gate.size(); ++k) {
+                    const Gate& g = gateList[n.gate[k]];
+                    if (g.height == rowHeight[r]) widthSum[r] += x[i][k] * g.width;
+                }
+            }
+        }
+        for (int r = 0; r < numRows; ++r) {
+            model.addConstr(widthSum[r] >= gamma * chipWidth, "c5[" + to_string(r) + "][lower]");
+            model.addConstr(widthSum[r] <= chipWidth, "c5[" + to_string(r) + "][upper]");
+        }
+        model.setObjective(areaSum, GRB_MINIMIZE);
+
+        // Lazily added timing rows
+        vector<GRBVar> iAT(numNodes), oATVar(numNodes);
+        vector<char> timed(numNodes, 0);
+        set<pair<int, int>> edgeAdded;      // (node, fanin index)
+        set<pair<int, int>> poAdded;        // (PO, fanin index)
+        size_t numRowsAdded = 0;
+        auto timeNode = [&](int i) {
+            if (timed[i]) return;
+            timed[i] = 1;
+            const Node& n = nodeList[i];
+            iAT[i] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, "iAT[" + n.name + "]");
+            oATVar[i] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, "oAT[" + n.name + "]");
+            GRBLinExpr delaySum = 0;
+            for (size_t k = 0; k < n.gate.size(); ++k) delaySum += x[i][k] * n.delay[k];
+            model.addConstr(oATVar[i] == iAT[i] + delaySum, "c3[" + n.name + "]");
+            ++numRowsAdded;
+        };
+        // Worst path into PO p under the current oAT, added as c2/c3/c4 rows;
+        // returns the number of new rows
+        auto addPath = [&](int p) {
+            size_t before = numRowsAdded;
+            int f;
+            poArrival(p, f);
+            if (f == -1) return (size_t)0;
+            const Edge& last = poFanin[p][f];
+            if (last.node == -1) return (size_t)0;     // PI wired to a PO: nothing to choose
+            // An existing c4 row may still have new edges upstream
+            if (poAdded.insert({p, f}).second) {
+                timeNode(last.node);
+                model.addConstr(oATVar[last.node] + last.delay <= maxDelay,
+                                "c4[po" + to_string(p) + "][" + to_string(f) + "]");
+                ++numRowsAdded;
+            }
+            for (int v = last.node; v != -1; ) {
+                const Node& n = nodeList[v];
+                int worst = -1;
+                double worstAT = 0;
+                for (size_t g = 0; g < n.fanin.size(); ++g) {
+                    const Edge& e = n.fanin[g];
+                    double at = e.node == -1 ? e.delay : oAT[e.node] + e.delay;
+                    if (worst == -1 || at > worstAT) {
+                        worst = g;
+                        worstAT = at;
+                    }
+                }
+                if (worst == -1) break;
+                const Edge& e = n.fanin[worst];
+                if (edgeAdded.insert({v, worst}).second) {
+                    string constrName = "c2[" + n.name + "][" + to_string(worst) + "]";
+                    if (e.node == -1) model.addConstr(iAT[v] >= e.delay, constrName);
+                    else {
+                        timeNode(e.node);
+                        model.addConstr(iAT[v] >= oATVar[e.node] + e.delay, constrName);
+                    }
+                    ++numRowsAdded;
+                }
+                v = e.node;
+            }
+            return numRowsAdded - before;
+        };
+
+        // Gurobi's default FeasibilityTol, accumulated over the c2/c3 rows of
+        // the longest path and the c4 row
+        vector<int> depth(numNodes, 1);
+        int maxDepth = 0;
+        for (int v : topoOrder) {
+            for (const Edge& e : nodeList[v].fanin) {
+                if (e.node != -1) depth[v] = max(depth[v], depth[e.node] + 1);
+            }
+            maxDepth = max(maxDepth, depth[v]);
+        }
+        const double timingTol = 1e-6 * max(1.0, maxDelay) * (2 * maxDepth + 1);
+
+        // Initial rows from the input assignment
+        sta();
+        int numPaths = 0;
+        for (int p = 0; p < numPOs; ++p) {
+            int f;
+            if (poArrival(p, f) >= (1.0 - margin) * maxDelay && addPath(p) > 0) ++numPaths;
+        }
+        cout << "Lazy timing: " << numPaths << " initial paths, " << numRowsAdded << " rows" << endl;
+
+        bool feasible = false;
+        for (int round = 0; round < maxRounds; ++round) {
+            model.optimize();
+            if (model.get(GRB_IntAttr_SolCount) == 0) {
+                cerr << "Lazy timing: no solution in round " << round << endl;
+                break;
+            }
+            for (int i = 0; i < numNodes; ++i) {
+                for (size_t k = 0; k < x[i].size(); ++k) {
+                    if (x[i][k].get(GRB_DoubleAttr_X) > 0.5) {
+                        nodeList[i].choice = k;
+                        break;
+                    }
+                }
+            }
+            sta();
+            size_t numNew = 0;
+            int numViolated = 0;
+            for (int p = 0; p < numPOs; ++p) {
+                int f;
+                if (poArrival(p, f) > maxDelay + timingTol) {
+                    ++numViolated;
+                    numNew += addPath(p);
+                }
+            }
+            cout << "Lazy timing round " << round << ": " << numViolated << " POs violated, "
+                 << numNew << " rows added, " << numRowsAdded << " in total" << endl;
+            if (numViolated == 0) {
+                feasible = true;
+                break;
+            }
+            if (numNew == 0) {
+                // Every violated path is already constrained, so the misses are numerical
+                cerr << "Lazy timing: " << numViolated << " POs exceed maxDelay by solver tolerances only, "
+                     << "keeping the assignment" << endl;
+                feasible = true;
+                break;
+            }
+        }
+        if (!feasible) {
+            // No result file, so a stale one is not applied either
+            cerr << "Lazy timing: the assignment does not meet maxDelay, no result written" << endl;
+            remove("NIMCH_gurobi_result.txt");
+            return 0;
+        }
+
+        // Output Results
+        ofstream outFile("NIMCH_gurobi_result.txt");
+        for (const Node& n : nodeList) {
+            outFile << n.name << " " << gateList[n.gate[n.choice]].name << "\n";
+        }
+        outFile.close();
+
+    } catch (GRBException e) {
+        cerr << "Error code = " << e.getErrorCode() << endl;
+        cerr << e.getMessage() << endl;
+    } catch (...) {
+        cerr << "Exception during optimization" << endl;
+    }
+
+    return 0;
+}
+)";
+
+bool Legalizer::_genGurobiLazy(double margin, int maxRounds) {
+    PROFILE_SCOPE("genGurobiLazy");
+    _writeLog("Generating the lazy-timing Gurobi model ...\n");
+
+    ofstream outFile("NIMCH_gurobi_lazy_c++.cpp");
+    if (!outFile.is_open()) {
+        cerr << "Error: Failed to open output file!" << endl;
+        return false;
+    }
+    outFile << lazySolverSource;
+    outFile.close();
+
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
+    int numRows = _chip->getNumRows();
+    double chipWidth = _chip->getBoundary().width();
+    const double gamma = _gamma;
+
+    ostringstream header;
+    header.precision(10);
+    header << "NIMCH_LAZY 1 " << numRows << " " << chipWidth << " " << gamma << " " << maxDelay << " "
+           << margin << " " << maxRounds << "\n";
+    if (!_writeGurobiTables("NIMCH_gurobi_lazy.txt", header.str())) return false;
+
+    _writeSuccessLog("Lazy-timing Gurobi model generated\n");
+    return true;
+}
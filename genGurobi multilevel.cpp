@@ -0,0 +1,418 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include "legalizer/legalizer.h"
+#include "util/profiler.h"
+
+using namespace std;
+
+/*
+Multilevel gate-height assignment
+    Timing is turned into per-node delay budgets by one STA pass on the input
+    assignment:
+        budget(i) = delay(i, init) + max(0, slack(i)) / depth(i)
+    where depth(i) is the number of nodes on the longest path through i. A
+    path of L nodes through i has slack >= slack(j) and L <= depth(j) for each
+    of its nodes j, so any choice within the budgets meets maxDelay and no
+    timing rows are needed. rep(i, h) is the smallest-area candidate of height
+    h within budget(i).
+    Coarsening: on each row, in x order, a cluster is merged with its right
+    neighbor when both have the same cone (the PO reached by following the
+    most critical fanout) and allow a common height, halving the problem per
+    level. A cluster takes one height h for all its members and contributes
+    sum rep widths / areas of its members to c5 and the objective.
+    The coarsest level is solved as a height assignment y[c][h] with c1, c5
+    and the area objective; each finer level starts from the projection of
+    the coarser solution. Level 0 is not solved flat: starting from the
+    projection of level 1, individual gate choices (x[i][k] over the
+    candidates within budget) are refined in windows of a few rows with the
+    rest of the design fixed (refineGates), so no model spans the design.
+    Every level, and the refinement as a whole, has a time limit of
+    levelTimeLimit seconds.
+
+_genGurobiMultilevel writes the tables (see _writeGurobiTables) with the x
+coordinates of the intNodes as the trailer to NIMCH_gurobi_multilevel.txt and
+a fixed solver program to NIMCH_gurobi_multilevel_c++.cpp.
+*/
+
+static const char* multilevelSolverSource = R"(/*
+ * This file is generated by NIMCHLegalizer (multilevel height assignment)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gurobi_c++.h"
+using namespace std;
+
+struct Gate { string name; int height; double width, area; };
+struct Edge { int node; double delay; };    // fanin: -1 is a PI; fanout: -2 - p is PO p
+struct Node {
+    string name;
+    int row, choice;
+    double x;
+    vector<int> gate;
+    vector<double> delay;
+    vector<Edge> fanin, fanout;
+};
+struct Cluster {
+    int row, cone;
+    double x;
+    vector<int> member;                     // level-0 nodes
+    bool allowed[2];
+    double width[2], area[2];
+};
+
+int numRows, numLevels, minClusters;
+double chipWidth, gamma_, maxDelay, levelTimeLimit;
+vector<int> rowHeight;
+vector<Gate> gateList;
+vector<Node> nodeList;
+vector<double> budget;
+vector<vector<int>> rep;                    // rep[i][h]: candidate index, -1 if none
+
+// Height assignment of one level, started from start (if not empty).
+// Returns the height of each cluster, or an empty vector without a solution
+vector<int> solveHeights(GRBEnv& env, const vector<Cluster>& clusterList, const vector<int>& start) {
+    GRBModel model(env);
+    vector<GRBVar> y[2];
+    GRBLinExpr areaSum = 0;
+    vector<GRBLinExpr> widthSum(numRows, 0);
+    for (int h = 0; h < 2; ++h) y[h].resize(clusterList.size());
+    for (size_t c = 0; c < clusterList.size(); ++c) {
+        const Cluster& cl = clusterList[c];
+        GRBLinExpr ySum = 0;
+        for (int h = 0; h < 2; ++h) {
+            if (!cl.allowed[h]) continue;
+            y[h][c] = model.addVar(0.0, 1.0, 0.0, GRB_BINARY);
+            if (!start.empty()) y[h][c].set(GRB_DoubleAttr_Start, start[c] == h ? 1.0 : 0.0);
+            ySum += y[h][c];
+            areaSum += y[h][c] * cl.area[h];
+            for (int r = max(0, cl.row - 1); r <= min(numRows - 1, cl.row + 1); ++r) {
+                if (rowHeight[r] == h) widthSum[r] += y[h][c] * cl.width[h];
+            }
+        }
+        model.addConstr(ySum == 1);                                 // (c1)
+    }
+    for (int r = 0; r < numRows; ++r) {                             // (c5)
+        model.addConstr(widthSum[r] >= gamma_ * chipWidth);
+        model.addConstr(widthSum[r] <= chipWidth);
+    }
+    model.setObjective(areaSum, GRB_MINIMIZE);
+    model.optimize();
+
+    vector<int> height;
+    if (model.get(GRB_IntAttr_SolCount) == 0) return height;
+    for (size_t c = 0; c < clusterList.size(); ++c) {
+        const Cluster& cl = clusterList[c];
+        height.push_back(cl.allowed[1] && (!cl.allowed[0] || y[1][c].get(GRB_DoubleAttr_X) > 0.5) ? 1 : 0);
+    }
+    return height;
+}
+
+// Gate choices of the individual nodes within their budgets, refined from the
+// rep gates of the given heights one window of windowRows rows at a time. The
+// nodes of the window are free; every other node keeps its current gate and
+// its width is folded into the c5 bounds of the rows next to the window. The
+// windows are swept twice, the second sweep shifted by half a window so that
+// no pair of rows stays on a window boundary. A window without a solution
+// keeps its gates. The windows share timeLimit seconds; returns the number of
+// windows solved.
+int refineGates(GRBEnv& env, const vector<int>& height, double timeLimit) {
+    const int windowRows = 8;
+    int numNodes = nodeList.size();
+    vector<vector<int>> onRow(numRows);
+    for (int i = 0; i < numNodes; ++i) {
+        nodeList[i].choice = rep[i][height[i]];
+        onRow[nodeList[i].row].push_back(i);
+    }
+    vector<int> windowList;
+    for (int r0 = 0; r0 < numRows; r0 += windowRows) windowList.push_back(r0);
+    for (int r0 = windowRows / 2; r0 < numRows; r0 += windowRows) windowList.push_back(r0);
+
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double>(timeLimit);
+    int numSolved = 0;
+    for (size_t w = 0; w < windowList.size(); ++w) {
+        double remaining = chrono::duration<double>(deadline - chrono::steady_clock::now()).count();
+        if (remaining <= 0) break;
+        int r0 = windowList[w], r1 = min(numRows, r0 + windowRows);     // free rows [r0, r1)
+        int c0 = max(0, r0 - 1), c1 = min(numRows - 1, r1);             // c5 rows touched
+        GRBModel model(env);
+        model.set(GRB_DoubleParam_TimeLimit, remaining / (windowList.size() - w));
+
+        vector<double> fixedWidth(c1 - c0 + 1, 0.0);
+        for (int r = c0; r <= c1; ++r) {
+            for (int q = max(0, r - 1); q <= min(numRows - 1, r + 1); ++q) {
+                if (q >= r0 && q < r1) continue;
+                for (int i : onRow[q]) {
+                    const Gate& g = gateList[nodeList[i].gate[nodeList[i].choice]];
+                    if (g.height == rowHeight[r]) fixedWidth[r - c0] += g.width;
+                }
+            }
+        }
+        vector<int> freeList;
+        for (int r = r0; r < r1; ++r) freeList.insert(freeList.end(), onRow[r].begin(), onRow[r].end());
+        vector<vector<GRBVar>> x(freeList.size());
+        vector<vector<int>> cand(freeList.size());
+        GRBLinExpr areaSum = 0;
+        vector<GRBLinExpr> widthSum(c1 - c0 + 1, 0);
+        for (size_t f = 0; f < freeList.size(); ++f) {
+            const Node& n = nodeList[freeList[f]];
+            GRBLinExpr xSum = 0;
+            for (size_t k = 0; k < n.gate.size(); ++k) {
+                const Gate& g = gateList[n.gate[k]];
+                if (n.delay[k] > budget[freeList[f]] && (int)k != n.choice) continue;
+                GRBVar v = model.addVar(0.0, 1.0, 0.0, GRB_BINARY);
+                v.set(GRB_DoubleAttr_Start, (int)k == n.choice ? 1.0 : 0.0);
+                cand[f].push_back(k);
+                x[f].push_back(v);
+                xSum += v;
+                areaSum += v * g.area;
+                for (int r = max(c0, n.row - 1); r <= min(c1, n.row + 1); ++r) {
+                    if (rowHeight[r] == g.height) widthSum[r - c0] += v * g.width;
+                }
+            }
+            model.addConstr(xSum == 1);                             // (c1)
+        }
+        for (int r = c0; r <= c1; ++r) {                            // (c5)
+            model.addConstr(widthSum[r - c0] + fixedWidth[r - c0] >= gamma_ * chipWidth);
+            model.addConstr(widthSum[r - c0] + fixedWidth[r - c0] <= chipWidth);
+        }
+        model.setObjective(areaSum, GRB_MINIMIZE);
+        model.optimize();
+
+        if (model.get(GRB_IntAttr_SolCount) == 0) continue;
+        for (size_t f = 0; f < freeList.size(); ++f) {
+            for (size_t j = 0; j < x[f].size(); ++j) {
+                if (x[f][j].get(GRB_DoubleAttr_X) > 0.5) nodeList[freeList[f]].choice = cand[f][j];
+            }
+        }
+        ++numSolved;
+    }
+    return numSolved;
+}
+
+int main() {
+    try {
+        ifstream inFile("NIMCH_gurobi_multilevel.txt");
+        if (!inFile.is_open()) {
+            cerr << "Error: Failed to open NIMCH_gurobi_multilevel.txt" << endl;
+            return 1;
+        }
+        string tag;
+        int version, numGates, numNodes, numPOs;
+        inFile >> tag >> version >> numRows >> chipWidth >> gamma_ >> maxDelay
+               >> numLevels >> minClusters >> levelTimeLimit;
+        rowHeight.resize(numRows);
+        for (int& h : rowHeight) inFile >> h;
+        inFile >> numGates;
+        gateList.resize(numGates);
+        for (Gate& g : gateList) inFile >> g.name >> g.height >> g.width >> g.area;
+        inFile >> numNodes;
+        nodeList.resize(numNodes);
+        for (Node& n : nodeList) {
+            int numCand, numFanin;
+            inFile >> n.name >> n.row >> n.choice >> numCand;
+            n.gate.resize(numCand);
+            n.delay.resize(numCand);
+            for (int k = 0; k < numCand; ++k) inFile >> n.gate[k] >> n.delay[k];
+            inFile >> numFanin;
+            n.fanin.resize(numFanin);
+            for (Edge& e : n.fanin) inFile >> e.node >> e.delay;
+        }
+        inFile >> numPOs;
+        for (int p = 0; p < numPOs; ++p) {
+            int numFanin;
+            inFile >> numFanin;
+            for (int f = 0; f < numFanin; ++f) {
+                Edge e;
+                inFile >> e.node >> e.delay;
+                if (e.node != -1) nodeList[e.node].fanout.push_back({-2 - p, e.delay});
+            }
+        }
+        for (Node& n : nodeList) inFile >> n.x;
+        inFile.close();
+
+        // Topological order, STA on the input assignment, depth and cone
+        vector<int> numPending(numNodes, 0), topoOrder;
+        for (int i = 0; i < numNodes; ++i) {
+            for (const Edge& e : nodeList[i].fanin) {
+                if (e.node != -1) {
+                    nodeList[e.node].fanout.push_back({i, e.delay});
+                    ++numPending[i];
+                }
+            }
+        }
+        for (int i = 0; i < numNodes; ++i) if (numPending[i] == 0) topoOrder.push_back(i);
+        for (size_t t = 0; t < topoOrder.size(); ++t) {
+            for (const Edge& e : nodeList[topoOrder[t]].fanout) {
+                if (e.node >= 0 && --numPending[e.node] == 0) topoOrder.push_back(e.node);
+            }
+        }
+        vector<double> oAT(numNodes, 0), reqOAT(numNodes, INFINITY);
+        vector<int> depthIn(numNodes, 1), depthOut(numNodes, 1), cone(numNodes, -1);
+        for (int i : topoOrder) {
+            const Node& n = nodeList[i];
+            double iAT = 0;
+            for (const Edge& e : n.fanin) {
+                iAT = max(iAT, e.node == -1 ? e.delay : oAT[e.node] + e.delay);
+                if (e.node != -1) depthIn[i] = max(depthIn[i], depthIn[e.node] + 1);
+            }
+            oAT[i] = iAT + n.delay[n.choice];
+        }
+        for (auto it = topoOrder.rbegin(); it != topoOrder.rend(); ++it) {
+            const Node& n = nodeList[*it];
+            for (const Edge& e : n.fanout) {
+                double req = (e.node < 0) ? maxDelay - e.delay
+                    : reqOAT[e.node] - nodeList[e.node].delay[nodeList[e.node].choice] - e.delay;
+                if (req < reqOAT[*it]) {
+                    reqOAT[*it] = req;
+                    cone[*it] = (e.node < 0) ? -2 - e.node : cone[e.node];
+                }
+                if (e.node >= 0) depthOut[*it] = max(depthOut[*it], depthOut[e.node] + 1);
+            }
+        }
+        budget.resize(numNodes);
+        rep.assign(numNodes, vector<int>(2, -1));
+        for (int i = 0; i < numNodes; ++i) {
+            const Node& n = nodeList[i];
+            double slack = std::isinf(reqOAT[i]) ? maxDelay : reqOAT[i] - oAT[i];
+            budget[i] = n.delay[n.choice] + max(0.0, slack) / (depthIn[i] + depthOut[i] - 1);
+            for (size_t k = 0; k < n.gate.size(); ++k) {
+                const Gate& g = gateList[n.gate[k]];
+                if (n.delay[k] > budget[i] && (int)k != n.choice) continue;
+                int& r = rep[i][g.height];
+                if (r == -1 || g.area < gateList[n.gate[r]].area
+                    || (g.area == gateList[n.gate[r]].area && n.delay[k] < n.delay[r])) r = k;
+            }
+        }
+
+        // Levels: levelList[0] holds one cluster per node
+        vector<vector<Cluster>> levelList(1);
+        vector<vector<int>> parentList;             // parentList[l][c]: cluster of level l+1
+        for (int i = 0; i < numNodes; ++i) {
+            Cluster cl;
+            cl.row = nodeList[i].row;
+            cl.cone = cone[i];
+            cl.x = nodeList[i].x;
+            cl.member = {i};
+            for (int h = 0; h < 2; ++h) {
+                cl.allowed[h] = rep[i][h] != -1;
+                cl.width[h] = cl.allowed[h] ? gateList[nodeList[i].gate[rep[i][h]]].width : 0;
+                cl.area[h] = cl.allowed[h] ? gateList[nodeList[i].gate[rep[i][h]]].area : 0;
+            }
+            levelList[0].push_back(cl);
+        }
+        while ((int)levelList.size() <= numLevels && (int)levelList.back().size() > minClusters) {
+            const vector<Cluster>& fine = levelList.back();
+            vector<vector<int>> onRow(numRows);
+            for (size_t c = 0; c < fine.size(); ++c) onRow[fine[c].row].push_back(c);
+            vector<Cluster> coarse;
+            vector<int> parent(fine.size(), -1);
+            for (vector<int>& row : onRow) {
+                sort(row.begin(), row.end(), [&](int a, int b) { return fine[a].x < fine[b].x; });
+                for (size_t j = 0; j < row.size(); ++j) {
+                    Cluster cl = fine[row[j]];
+                    parent[row[j]] = coarse.size();
+                    if (j + 1 < row.size()) {
+                        const Cluster& next = fine[row[j + 1]];
+                        bool common = (cl.allowed[0] && next.allowed[0]) || (cl.allowed[1] && next.allowed[1]);
+                        if (next.cone == cl.cone && common) {
+                            for (int h = 0; h < 2; ++h) {
+                                cl.allowed[h] = cl.allowed[h] && next.allowed[h];
+                                cl.width[h] += next.width[h];
+                                cl.area[h] += next.area[h];
+                            }
+                            cl.member.insert(cl.member.end(), next.member.begin(), next.member.end());
+                            parent[row[++j]] = coarse.size();
+                        }
+                    }
+                    coarse.push_back(move(cl));
+                }
+            }
+            if (coarse.size() > 0.9 * fine.size()) break;
+            parentList.push_back(move(parent));
+            levelList.push_back(move(coarse));
+        }
+
+        GRBEnv env = GRBEnv(true);
+        env.set("LogFile", "NIMCH_gurobi.log");
+        env.set(GRB_DoubleParam_TimeLimit, levelTimeLimit);
+        env.start();
+
+        // Coarsest to finest; a level without a solution keeps the projection.
+        // Level 0 is not solved flat: it takes the projection of level 1 (or
+        // the input heights without coarsening) and refineGates refines it
+        vector<int> height;
+        for (int l = levelList.size() - 1; l >= 1; --l) {
+            vector<int> start;
+            if (!height.empty()) {
+                for (size_t c = 0; c < levelList[l].size(); ++c) start.push_back(height[parentList[l][c]]);
+            }
+            vector<int> solved = solveHeights(env, levelList[l], start);
+            cout << "Level " << l << ": " << levelList[l].size() << " clusters"
+                 << (solved.empty() ? ", no solution" : "") << endl;
+            height = solved.empty() ? start : solved;
+        }
+        vector<int> nodeHeight(numNodes);
+        for (int i = 0; i < numNodes; ++i) {
+            const Node& n = nodeList[i];
+            nodeHeight[i] = height.empty() ? gateList[n.gate[n.choice]].height : height[parentList[0][i]];
+        }
+        int numSolved = refineGates(env, nodeHeight, levelTimeLimit);
+        cout << "Level 0: " << numNodes << " nodes, " << numSolved << " row windows refined" << endl;
+
+        ofstream outFile("NIMCH_gurobi_result.txt");
+        for (const Node& n : nodeList) {
+            outFile << n.name << " " << gateList[n.gate[n.choice]].name << "\n";
+        }
+        outFile.close();
+
+    } catch (GRBException e) {
+        cerr << "Error code = " << e.getErrorCode() << endl;
+        cerr << e.getMessage() << endl;
+    } catch (...) {
+        cerr << "Exception during optimization" << endl;
+    }
+
+    return 0;
+}
+)";
+
+bool Legalizer::_genGurobiMultilevel(int numLevels, int minClusters, double levelTimeLimit) {
+    PROFILE_SCOPE("genGurobiMultilevel");
+    _writeLog("Generating the multilevel Gurobi model ...\n");
+
+    ofstream outFile("NIMCH_gurobi_multilevel_c++.cpp");
+    if (!outFile.is_open()) {
+        cerr << "Error: Failed to open output file!" << endl;
+        return false;
+    }
+    outFile << multilevelSolverSource;
+    outFile.close();
+
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
+    int numRows = _chip->getNumRows();
+    double chipWidth = _chip->getBoundary().width();
+    const double gamma = _gamma;
+
+    ostringstream header, trailer;
+    header.precision(10);
+    header << "NIMCH_MULTILEVEL 1 " << numRows << " " << chipWidth << " " << gamma << " "
+           << maxDelay << " " << numLevels << " " << minClusters << " " << levelTimeLimit << "\n";
+    trailer.precision(10);
+    for (const sPtr<IntNode>& intNode : _chip->netlist->getIntNodeList()) {
+        trailer << (double)intNode->getBoundary().x1() << "\n";
+    }
+    if (!_writeGurobiTables("NIMCH_gurobi_multilevel.txt", header.str(), trailer.str())) return false;
+
+    _writeSuccessLog("Multilevel Gurobi model generated\n");
+    return true;
+}
@@ -0,0 +1,362 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include "legalizer/legalizer.h"
+
+using namespace std;
+
+/*
+Row-band decomposition of the gate-selection model
+    The die is cut into bands of bandRows rows. Each band is a subproblem over
+    the x[i][k], iAT[i], oAT[i] of its own nodes:
+        - (c5) rows just outside the band are fixed to the current assignment
+          (the one-row halo is the overlap between neighboring bands); the
+          windows centered on those halo rows are constrained too, since
+          they contain band rows
+        - (c2) fanins outside the band contribute their current arrival time
+        - (c4) every fanout edge leaving the band gets a required-time budget
+          from an STA pass on the current assignment
+    Bands of the same parity are at least two rows apart, so they share no
+    c5 window, and are solved concurrently; even bands first, then odd
+    bands after a fresh STA pass.
+    Timing paths are not row-local, so two concurrent bands on one path can
+    both spend its slack. After each parity the new choices are checked by
+    STA, and every band with a changed node on a path that misses maxDelay
+    is rolled back, until no such band remains.
+    Each iteration shifts the band boundaries by half a band so that the
+    previous boundaries are refined as band interiors.
+
+_genGurobiBands writes the design as integer-indexed tables to
+NIMCH_gurobi_bands.txt (see _writeGurobiTables) and a fixed solver program
+to NIMCH_gurobi_bands_c++.cpp, whose size does not depend on the design.
+*/
+
+static const char* bandSolverSource = R"(/*
+ * This file is generated by NIMCHLegalizer (row-band decomposition)
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gurobi_c++.h"
+using namespace std;
+
+struct Gate { string name; int height; double width, area; };
+struct Edge { int node; double delay; };    // node == -1: delay is an absolute arrival time
+struct Node {
+    string name;
+    int row, choice;
+    vector<int> gate;
+    vector<double> delay;
+    vector<Edge> fanin, fanout;             // fanout.node == -1: PO
+};
+
+int numRows, bandRows, numIters;
+double chipWidth, gamma_, maxDelay, bandTimeLimit;
+vector<int> rowHeight;
+vector<Gate> gateList;
+vector<Node> nodeList;
+vector<int> topoOrder;
+vector<vector<int>> nodesOnRow;
+vector<double> oAT, reqOAT;
+const double timingTol = 1e-6;              // Gurobi's default FeasibilityTol
+
+void sta() {
+    for (int i : topoOrder) {
+        Node& n = nodeList[i];
+        double iAT = 0;
+        for (const Edge& e : n.fanin) {
+            iAT = max(iAT, e.node == -1 ? e.delay : oAT[e.node] + e.delay);
+        }
+        oAT[i] = iAT + n.delay[n.choice];
+    }
+    for (auto it = topoOrder.rbegin(); it != topoOrder.rend(); ++it) {
+        Node& n = nodeList[*it];
+        double req = INFINITY;
+        for (const Edge& e : n.fanout) {
+            double reqIAT = (e.node == -1) ? maxDelay
+                : reqOAT[e.node] - nodeList[e.node].delay[nodeList[e.node].choice];
+            req = min(req, reqIAT - e.delay);
+        }
+        reqOAT[*it] = req;
+    }
+}
+
+// Solves rows [lo, hi) with everything else fixed; returns the new choices of
+// the band's nodes or an empty vector if no improving solution was found
+vector<int> solveBand(GRBEnv& env, int lo, int hi, const vector<int>& bandNodes) {
+    auto inBand = [&](int i) { return i >= 0 && nodeList[i].row >= lo && nodeList[i].row < hi; };
+    GRBModel model(env);
+    vector<vector<GRBVar>> x(bandNodes.size());
+    vector<GRBVar> iAT(bandNodes.size()), oATVar(bandNodes.size());
+    unordered_map<int, int> local;
+    for (size_t b = 0; b < bandNodes.size(); ++b) local[bandNodes[b]] = b;
+
+    GRBLinExpr areaSum = 0;
+    for (size_t b = 0; b < bandNodes.size(); ++b) {
+        const Node& n = nodeList[bandNodes[b]];
+        GRBLinExpr xSum = 0, delaySum = 0;
+        for (size_t k = 0; k < n.gate.size(); ++k) {
+            x[b].push_back(model.addVar(0.0, 1.0, 0.0, GRB_BINARY));
+            x[b][k].set(GRB_DoubleAttr_Start, (int)k == n.choice ? 1.0 : 0.0);
+            xSum += x[b][k];
+            delaySum += x[b][k] * n.delay[k];
+            areaSum += x[b][k] * gateList[n.gate[k]].area;
+        }
+        iAT[b] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS);
+        oATVar[b] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS);
+        model.addConstr(xSum == 1);                                 // (c1)
+        model.addConstr(oATVar[b] == iAT[b] + delaySum);            // (c3)
+    }
+    for (size_t b = 0; b < bandNodes.size(); ++b) {
+        const Node& n = nodeList[bandNodes[b]];
+        for (const Edge& e : n.fanin) {                             // (c2)
+            if (inBand(e.node)) model.addConstr(iAT[b] >= oATVar[local[e.node]] + e.delay);
+            else model.addConstr(iAT[b] >= (e.node == -1 ? e.delay : oAT[e.node] + e.delay));
+        }
+        double budget = INFINITY;
+        for (const Edge& e : n.fanout) {                            // (c4) budgeted
+            if (e.node == -1) budget = min(budget, maxDelay - e.delay);
+            else if (!inBand(e.node)) {
+                const Node& m = nodeList[e.node];
+                budget = min(budget, reqOAT[e.node] - m.delay[m.choice] - e.delay);
+            }
+        }
+        if (budget < INFINITY) model.addConstr(oATVar[b] <= budget);
+    }
+    // (c5) every window that contains a band row, including the seam windows
+    // lo-1 and hi, whose other rows are fixed
+    int wLo = max(0, lo - 1), wHi = min(numRows, hi + 1);
+    vector<GRBLinExpr> widthSum(wHi - wLo, 0);
+    vector<double> fixedWidth(wHi - wLo, 0);
+    for (int q = max(0, wLo - 1); q < min(numRows, wHi + 1); ++q) {
+        for (int i : nodesOnRow[q]) {
+            const Node& n = nodeList[i];
+            for (int r = max(wLo, q - 1); r <= min(wHi - 1, q + 1); ++r) {
+                if (inBand(i)) {
+                    for (size_t k = 0; k < n.gate.size(); ++k) {
+                        const Gate& g = gateList[n.gate[k]];
+                        if (g.height == rowHeight[r]) widthSum[r - wLo] += x[local[i]][k] * g.width;
+                    }
+                }
+                else {
+                    const Gate& g = gateList[n.gate[n.choice]];
+                    if (g.height == rowHeight[r]) fixedWidth[r - wLo] += g.width;
+                }
+            }
+        }
+    }
+    for (int r = wLo; r < wHi; ++r) {
+        model.addConstr(widthSum[r - wLo] + fixedWidth[r - wLo] >= gamma_ * chipWidth);
+        model.addConstr(widthSum[r - wLo] + fixedWidth[r - wLo] <= chipWidth);
+    }
+    model.setObjective(areaSum, GRB_MINIMIZE);
+    model.optimize();
+
+    vector<int> choice;
+    if (model.get(GRB_IntAttr_SolCount) == 0) return choice;
+    for (size_t b = 0; b < bandNodes.size(); ++b) {
+        int best = 0;
+        for (size_t k = 1; k < x[b].size(); ++k) {
+            if (x[b][k].get(GRB_DoubleAttr_X) > x[b][best].get(GRB_DoubleAttr_X)) best = k;
+        }
+        choice.push_back(best);
+    }
+    return choice;
+}
+
+int main() {
+    try {
+        ifstream inFile("NIMCH_gurobi_bands.txt");
+        string tag;
+        int version, numGates, numNodes;
+        inFile >> tag >> version >> numRows >> chipWidth >> gamma_ >> maxDelay
+               >> bandRows >> numIters >> bandTimeLimit;
+        rowHeight.resize(numRows);
+        for (int& h : rowHeight) inFile >> h;
+        inFile >> numGates;
+        gateList.resize(numGates);
+        for (Gate& g : gateList) inFile >> g.name >> g.height >> g.width >> g.area;
+        inFile >> numNodes;
+        nodeList.resize(numNodes);
+        for (Node& n : nodeList) {
+            int numCand, numFanin;
+            inFile >> n.name >> n.row >> n.choice >> numCand;
+            n.gate.resize(numCand);
+            n.delay.resize(numCand);
+            for (int k = 0; k < numCand; ++k) inFile >> n.gate[k] >> n.delay[k];
+            inFile >> numFanin;
+            n.fanin.resize(numFanin);
+            for (Edge& e : n.fanin) inFile >> e.node >> e.delay;
+        }
+        int numPOs;
+        inFile >> numPOs;
+        for (int p = 0; p < numPOs; ++p) {
+            int numFanin;
+            inFile >> numFanin;
+            for (int f = 0; f < numFanin; ++f) {
+                Edge e;
+                inFile >> e.node >> e.delay;
+                if (e.node != -1) nodeList[e.node].fanout.push_back({-1, e.delay});
+            }
+        }
+        vector<int> numPending(numNodes, 0);
+        for (int i = 0; i < numNodes; ++i) {
+            for (const Edge& e : nodeList[i].fanin) {
+                if (e.node != -1) {
+                    nodeList[e.node].fanout.push_back({i, e.delay});
+                    ++numPending[i];
+                }
+            }
+        }
+        for (int i = 0; i < numNodes; ++i) if (numPending[i] == 0) topoOrder.push_back(i);
+        for (size_t t = 0; t < topoOrder.size(); ++t) {
+            for (const Edge& e : nodeList[topoOrder[t]].fanout) {
+                if (e.node != -1 && --numPending[e.node] == 0) topoOrder.push_back(e.node);
+            }
+        }
+        nodesOnRow.resize(numRows);
+        for (int i = 0; i < numNodes; ++i) nodesOnRow[nodeList[i].row].push_back(i);
+        oAT.assign(numNodes, 0);
+        reqOAT.assign(numNodes, INFINITY);
+
+        unsigned numThreads = max(1u, thread::hardware_concurrency());
+        vector<GRBEnv*> envList;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            GRBEnv* env = new GRBEnv(true);
+            env->set(GRB_IntParam_OutputFlag, 0);
+            env->set(GRB_IntParam_Threads, 1);
+            env->set(GRB_DoubleParam_TimeLimit, bandTimeLimit);
+            env->start();
+            envList.push_back(env);
+        }
+
+        for (int it = 0; it < numIters; ++it) {
+            int offset = (it % 2) ? bandRows / 2 : 0;
+            vector<pair<int, int>> bandList;
+            for (int lo = 0, hi = offset ? offset : bandRows; lo < numRows; lo = hi, hi += bandRows) {
+                bandList.push_back({lo, min(hi, numRows)});
+            }
+            vector<vector<int>> bandNodes(bandList.size());
+            vector<int> bandOfRow(numRows);
+            for (size_t b = 0; b < bandList.size(); ++b) {
+                for (int r = bandList[b].first; r < bandList[b].second; ++r) bandOfRow[r] = b;
+            }
+            for (int i = 0; i < numNodes; ++i) bandNodes[bandOfRow[nodeList[i].row]].push_back(i);
+
+            int numChanged = 0, numRolledBack = 0;
+            for (int parity = 0; parity < 2; ++parity) {
+                sta();
+                atomic<size_t> next(parity);
+                vector<vector<int>> result(bandList.size());
+                auto worker = [&](unsigned t) {
+                    for (size_t b; (b = next.fetch_add(2)) < bandList.size(); ) {
+                        result[b] = solveBand(*envList[t], bandList[b].first, bandList[b].second, bandNodes[b]);
+                    }
+                };
+                vector<thread> threadList;
+                for (unsigned t = 0; t < numThreads; ++t) threadList.emplace_back(worker, t);
+                for (thread& th : threadList) th.join();
+
+                // Apply the bands, then roll back every band that has a changed
+                // node with negative slack (a path through it misses maxDelay)
+                vector<vector<int>> previous(bandList.size());
+                for (size_t b = parity; b < bandList.size(); b += 2) {
+                    if (result[b].empty()) continue;
+                    for (size_t j = 0; j < result[b].size(); ++j) {
+                        Node& n = nodeList[bandNodes[b][j]];
+                        previous[b].push_back(n.choice);
+                        n.choice = result[b][j];
+                    }
+                }
+                while (true) {
+                    sta();
+                    vector<char> violated(bandList.size(), 0);
+                    bool anyViolated = false;
+                    for (size_t b = parity; b < bandList.size(); b += 2) {
+                        for (size_t j = 0; j < previous[b].size(); ++j) {
+                            int i = bandNodes[b][j];
+                            if (nodeList[i].choice != previous[b][j] && oAT[i] > reqOAT[i] + timingTol) {
+                                violated[b] = 1;
+                            }
+                        }
+                        anyViolated = anyViolated || violated[b];
+                    }
+                    if (!anyViolated) break;
+                    for (size_t b = parity; b < bandList.size(); b += 2) {
+                        if (!violated[b]) continue;
+                        for (size_t j = 0; j < previous[b].size(); ++j) {
+                            nodeList[bandNodes[b][j]].choice = previous[b][j];
+                        }
+                        previous[b].clear();
+                        ++numRolledBack;
+                    }
+                }
+                for (size_t b = parity; b < bandList.size(); b += 2) {
+                    for (size_t j = 0; j < previous[b].size(); ++j) {
+                        if (nodeList[bandNodes[b][j]].choice != previous[b][j]) ++numChanged;
+                    }
+                }
+            }
+            cout << "Iteration " << it << ": " << bandList.size() << " bands, "
+                 << numChanged << " gates changed, " << numRolledBack << " bands rolled back" << endl;
+            if (numChanged == 0 && it > 0) break;
+        }
+
+        ofstream outFile("NIMCH_gurobi_result.txt");
+        for (const Node& n : nodeList) {
+            outFile << n.name << " " << gateList[n.gate[n.choice]].name << "\n";
+        }
+        outFile.close();
+        for (GRBEnv* env : envList) delete env;
+
+    } catch (GRBException e) {
+        cerr << "Error code = " << e.getErrorCode() << endl;
+        cerr << e.getMessage() << endl;
+    } catch (...) {
+        cerr << "Exception during optimization" << endl;
+    }
+
+    return 0;
+}
+)";
+
+bool Legalizer::_genGurobiBands(int bandRows, int numIters, double bandTimeLimit) {
+    _writeLog("Generating the row-band Gurobi model ...\n");
+    // Same-parity bands must be two rows apart to share no c5 window
+    if (bandRows < 2) {
+        _writeErrorLog("Error: bandRows must be at least 2!\n");
+        return false;
+    }
+
+    ofstream outFile("NIMCH_gurobi_bands_c++.cpp");
+    if (!outFile.is_open()) {
+        cerr << "Error: Failed to open output file!" << endl;
+        return false;
+    }
+    outFile << bandSolverSource;
+    outFile.close();
+
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
+    int numRows = _chip->getNumRows();
+    double chipWidth = _chip->getBoundary().width();
+    const double gamma = _gamma;
+
+    ostringstream header;
+    header.precision(10);
+    header << "NIMCH_BANDS 1 " << numRows << " " << chipWidth << " " << gamma << " "
+           << maxDelay << " " << bandRows << " " << numIters << " " << bandTimeLimit << "\n";
+    if (!_writeGurobiTables("NIMCH_gurobi_bands.txt", header.str())) return false;
+
+    _writeSuccessLog("Row-band Gurobi model generated\n");
+    return true;
+}
@@ -0,0 +1,236 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <charconv>
+#include <unordered_map>
+#include <algorithm>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "legalizer/legalizer.h"
+#include "util/profiler.h"
+
+using namespace std;
+
+/*
+Integer-indexed tables of the gate-selection model, shared by the fixed
+programs that _genGurobi, _genGurobiBands, _genGurobiEco, _genGurobiLazy and
+_genGurobiMultilevel emit. The file is
+<header> (one line owned by each generator), the tables, then <trailer>:
+    <rowHeight[0]> ... <rowHeight[numRows-1]>              (0: short, 1: tall)
+    <numGates>
+    <name> <height> <width> <area>                         (numGates lines)
+    <numNodes>
+    <name> <row> <init> <numCand> {<gate> <delay>} <numFanin> {<node> <delay>}
+    <numPOs>
+    <numFanin> {<node> <delay>}                             (numPOs lines)
+Only candidate gates (_getCandidateGates) are numbered; <init> is the
+candidate index of the node's gate in the input DEF. A DEF gate that is not
+a candidate (e.g. it is dominated) is listed as one more candidate after
+them, so <init> always names the input gate. A fanin <node> of -1 is a PI
+and its <delay> is the PI arrival time plus the wire delay.
+
+Delays and fanins come from the delay tables (_buildFaninTable). Candidates
+and gate numbers are resolved serially (the candidate cache is not
+thread-safe); the node and PO lines, which are almost all of the file,
+are then formatted with std::to_chars by one thread per chunk into
+preallocated buffers and written with a single writev.
+*/
+
+namespace {
+
+class TableBuffer {
+public:
+    explicit TableBuffer(size_t reserve) { _buf.reserve(reserve); }
+
+    TableBuffer& operator<<(const std::string& s) { _buf.append(s); return *this; }
+    TableBuffer& operator<<(char c) { _buf.push_back(c); return *this; }
+    TableBuffer& operator<<(long long v) {
+        char tmp[24];
+        _buf.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v).ptr);
+        return *this;
+    }
+    TableBuffer& operator<<(int v) { return *this << (long long)v; }
+    TableBuffer& operator<<(size_t v) { return *this << (long long)v; }
+    // Same digits as an ostream with precision(10)
+    TableBuffer& operator<<(double v) {
+        char tmp[32];
+        _buf.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v, std::chars_format::general, 10).ptr);
+        return *this;
+    }
+
+    std::string& str() { return _buf; }
+
+private:
+    std::string _buf;
+};
+
+bool writeAll(int fd, std::vector<std::string*>& partList) {
+    std::vector<iovec> iovList;
+    for (std::string* part : partList) {
+        if (!part->empty()) iovList.push_back({&(*part)[0], part->size()});
+    }
+    size_t first = 0;
+    while (first < iovList.size()) {
+        int count = std::min<size_t>(iovList.size() - first, IOV_MAX);
+        ssize_t n = writev(fd, &iovList[first], count);
+        if (n < 0) return false;
+        // Skip what was written, including a partially written iovec
+        while (first < iovList.size() && (size_t)n >= iovList[first].iov_len) {
+            n -= iovList[first].iov_len;
+            ++first;
+        }
+        if (first < iovList.size() && n > 0) {
+            iovList[first].iov_base = (char*)iovList[first].iov_base + n;
+            iovList[first].iov_len -= n;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool Legalizer::_writeGurobiTables(const std::string& fileName, const std::string& header,
+                                   const std::string& trailer) {
+    PROFILE_SCOPE("writeGurobiTables");
+    const auto& intNodeList = _chip->netlist->getIntNodeList();
+    const auto& poList = _chip->netlist->getPOList();
+    int numRows = _chip->getNumRows();
+    size_t numNodes = intNodeList.size();
+
+    if (!_buildFaninTable()) return false;
+    unordered_map<string, int> gateIdx;
+    vector<sPtr<LibGate>> gateList;
+
+    TableBuffer head(64 + 2 * numRows);
+    head << header;
+    for (int r=0; r<numRows; ++r) {
+        head << (_chip->isRowShort(r) ? 0 : 1) << (r+1 == numRows ? '\n' : ' ');
+    }
+
+    // Gates are numbered on first use so that only candidates are written
+    vector<int> candOffset(numNodes + 1, 0);
+    vector<int> candList;
+    vector<double> candDelay;
+    vector<int> initList(numNodes, 0);
+    auto addCand = [&](const sPtr<LibGate>& libGate, double delay) {
+        auto it = gateIdx.find(libGate->getName());
+        if (it == gateIdx.end()) {
+            it = gateIdx.emplace(libGate->getName(), gateList.size()).first;
+            gateList.push_back(libGate);
+        }
+        candList.push_back(it->second);
+        candDelay.push_back(delay);
+    };
+    for (size_t i=0; i<numNodes; ++i) {
+        const sPtr<IntNode>& intNode = intNodeList[i];
+        const vector<sPtr<LibGate>>& candGates = _getCandidateGates(intNode);
+        const vector<int>& candIdx = _getCandidateGateIdx(intNode);
+        const double* delay = _delayArena.data() + _delayOffset[i];
+        const LibGate* origin = intNode->getLibGate().get();
+        int init = origin ? -1 : 0;
+        for (size_t c=0; c<candIdx.size(); ++c) {
+            if (candGates[c].get() == origin) init = c;
+            addCand(candGates[c], delay[candIdx[c]]);
+        }
+        if (init == -1) {
+            // The input gate was pruned; keep it selectable so <init> is exact
+            int k = _libGateIndex(intNode, origin);
+            if (k == -1) {
+                _writeErrorLog("Error: Gate " + origin->getName() + " of " + intNode->getName()
+                               + " does not implement its logic!\n");
+                return false;
+            }
+            init = candIdx.size();
+            addCand(_gateLibrary->getLibGateList(intNode->getLogic())[k], delay[k]);
+        }
+        initList[i] = init;
+        candOffset[i + 1] = candList.size();
+    }
+    head << gateList.size() << '\n';
+    for (const sPtr<LibGate>& libGate : gateList) {
+        head << libGate->getName() << ' ' << (libGate->isShort() ? 0 : 1) << ' '
+             << (double)libGate->getBoundary().width() << ' ' << (double)libGate->getBoundary().area() << '\n';
+    }
+    head << numNodes << '\n';
+
+    // fanin edge: (intNode idx, wire delay) or (-1, PI oAT + wire delay)
+    auto writeFanin = [&](TableBuffer& buf, const vector<int>& faninWire, int begin, int end) {
+        buf << ' ' << end - begin;
+        for (int f=begin; f<end; ++f) {
+            int w = faninWire[f];
+            buf << ' ' << _wireSource[w] << ' ' << _wireArrival[w] + _wireDelay[w];
+        }
+    };
+
+    // Node lines in chunks, PO lines as one more task
+    unsigned numThreads = max(1u, thread::hardware_concurrency());
+    if (numNodes < 16384) numThreads = 1;
+    size_t chunk = (numNodes + numThreads - 1) / max(1u, numThreads);
+    size_t bytesPerNode = 48 + 24 * (candList.size() / max<size_t>(1, numNodes) + 4);
+    vector<TableBuffer> nodeBuf;
+    for (unsigned t=0; t<numThreads; ++t) {
+        nodeBuf.emplace_back(chunk * bytesPerNode);
+    }
+    TableBuffer poBuf(16 + 64 * poList.size());
+
+    auto formatNodes = [&](unsigned t) {
+        TableBuffer& buf = nodeBuf[t];
+        size_t begin = t * chunk, end = min(numNodes, begin + chunk);
+        for (size_t i=begin; i<end; ++i) {
+            const sPtr<IntNode>& intNode = intNodeList[i];
+            buf << intNode->getName() << ' ' << intNode->getRow() << ' ' << initList[i] << ' '
+                << candOffset[i + 1] - candOffset[i];
+            for (int c=candOffset[i]; c<candOffset[i + 1]; ++c) {
+                buf << ' ' << candList[c] << ' ' << candDelay[c];
+            }
+            writeFanin(buf, _faninWire, _faninOffset[i], _faninOffset[i + 1]);
+            buf << '\n';
+        }
+    };
+    auto formatPOs = [&]() {
+        poBuf << poList.size() << '\n';
+        for (size_t p=0; p<poList.size(); ++p) {
+            writeFanin(poBuf, _poFaninWire, _poFaninOffset[p], _poFaninOffset[p + 1]);
+            poBuf << '\n';
+        }
+    };
+
+    vector<thread> threadList;
+    for (unsigned t=1; t<numThreads; ++t) {
+        threadList.emplace_back(formatNodes, t);
+    }
+    if (numThreads > 1) threadList.emplace_back(formatPOs);
+    formatNodes(0);
+    if (numThreads == 1) formatPOs();
+    for (auto& th : threadList) {
+        th.join();
+    }
+
+    int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Error: Failed to open output file!" << endl;
+        return false;
+    }
+    string tail = trailer;
+    vector<string*> partList = {&head.str()};
+    for (TableBuffer& buf : nodeBuf) {
+        partList.push_back(&buf.str());
+    }
+    partList.push_back(&poBuf.str());
+    partList.push_back(&tail);
+    bool ok = writeAll(fd, partList);
+    close(fd);
+    if (!ok) {
+        _writeErrorLog("Error: Failed to write " + fileName + "\n");
+        return false;
+    }
+    size_t numBytes = 0;
+    for (string* part : partList) {
+        numBytes += part->size();
+    }
+    PROFILE_COUNT("tableBytes", numBytes);
+    return true;
+}
@@ -0,0 +1,185 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <queue>
+#include "legalizer/legalizer.h"
+#include "util/ptrSpan.h"
+
+using namespace std;
+
+/*
+MIP start (NIMCH_gurobi.mst) for the model written by _genGurobi
+    - start from the libGate each intNode was given in the input DEF
+    - (c1) if that gate is not a candidate of the node's logic, take the
+      smallest-area candidate with the same height
+    - (c5) greedily flip the height of single nodes until every row window
+      satisfies gamma*W_chip <= widthSum <= W_chip, or no flip helps
+Only x[i][k] are written; Gurobi completes iAT/oAT from c2-c4.
+*/
+
+bool Legalizer::_genGurobiMipStart(double gamma) {
+    _writeLog("Generating the Gurobi MIP start ...\n");
+
+    ofstream outFile("NIMCH_gurobi.mst");
+    if (!outFile.is_open()) {
+        cerr << "Error: Failed to open output file!" << endl;
+        return false;
+    }
+
+    const auto& intNodeList = _chip->netlist->getIntNodeList();
+    int numRows = _chip->getNumRows();
+    double chipWidth = _chip->getBoundary().width();
+    size_t numNodes = intNodeList.size();
+
+    // Initial assignment + c1 repair
+    vector<PtrSpan<LibGate>> gateList(numNodes);
+    vector<int> choice(numNodes, -1);
+    vector<int> rowOf(numNodes);
+    for (size_t i=0; i<numNodes; ++i) {
+        const sPtr<IntNode>& intNode = intNodeList[i];
+        gateList[i] = _getCandidateGates(intNode);
+        rowOf[i] = intNode->getRow();
+        const LibGate* origin = intNode->getLibGate().get();
+        for (size_t k=0; k<gateList[i].size(); ++k) {
+            if (origin && gateList[i][k]->getName() == origin->getName()) {
+                choice[i] = k;
+                break;
+            }
+        }
+        if (choice[i] == -1) {
+            LibGate::height height = _chip->isRowShort(rowOf[i]) ? LibGate::height::SHORT : LibGate::height::TALL;
+            double bestArea = INFINITY;
+            for (size_t k=0; k<gateList[i].size(); ++k) {
+                double area = gateList[i][k]->getBoundary().area();
+                bool sameHeight = gateList[i][k]->getHeight() == height;
+                bool bestSameHeight = choice[i] != -1 && gateList[i][choice[i]]->getHeight() == height;
+                if ((sameHeight && !bestSameHeight) || (sameHeight == bestSameHeight && area < bestArea)) {
+                    choice[i] = k;
+                    bestArea = area;
+                }
+            }
+        }
+    }
+
+    // For each node, the smallest-area candidate of each height (used for flips)
+    vector<int> smallestShort(numNodes, -1), smallestTall(numNodes, -1);
+    for (size_t i=0; i<numNodes; ++i) {
+        for (size_t k=0; k<gateList[i].size(); ++k) {
+            int& best = (gateList[i][k]->getHeight() == LibGate::height::SHORT) ? smallestShort[i] : smallestTall[i];
+            if (best == -1 || gateList[i][k]->getBoundary().area() < gateList[i][best]->getBoundary().area()) {
+                best = k;
+            }
+        }
+    }
+
+    // c5 window sums: widthSum[r] sums nodes on rows r-1..r+1 whose gate height matches row r
+    vector<double> widthSum(numRows, 0.0);
+    vector<vector<int>> nodesOnRow(numRows);
+    auto contribute = [&](int i, int k, double sign) {
+        LibGate::height height = gateList[i][k]->getHeight();
+        double width = gateList[i][k]->getBoundary().width();
+        for (int r=rowOf[i]-1; r<=rowOf[i]+1; ++r) {
+            if (r >= 0 && r < numRows) {
+                LibGate::height rowHeight = _chip->isRowShort(r) ? LibGate::height::SHORT : LibGate::height::TALL;
+                if (rowHeight == height) widthSum[r] += sign * width;
+            }
+        }
+    };
+    for (size_t i=0; i<numNodes; ++i) {
+        if (choice[i] == -1) continue;
+        contribute(i, choice[i], 1.0);
+        if (rowOf[i] >= 0 && rowOf[i] < numRows) nodesOnRow[rowOf[i]].push_back(i);
+    }
+    auto violation = [&](int r) {
+        double lower = gamma * chipWidth;
+        if (widthSum[r] > chipWidth) return widthSum[r] - chipWidth;
+        if (widthSum[r] < lower) return lower - widthSum[r];
+        return 0.0;
+    };
+    auto localViolation = [&](int q) {
+        double sum = 0;
+        for (int r=q-2; r<=q+2; ++r) {
+            if (r >= 0 && r < numRows) sum += violation(r);
+        }
+        return sum;
+    };
+
+    // Gain of flipping node i to its smallest gate of the other height (in
+    // flipGate), measured on the windows around its row
+    auto flipGain = [&](int i, int& flipGate) {
+        bool isShort = gateList[i][choice[i]]->getHeight() == LibGate::height::SHORT;
+        flipGate = isShort ? smallestTall[i] : smallestShort[i];
+        if (flipGate == -1) return 0.0;
+        double before = localViolation(rowOf[i]);
+        contribute(i, choice[i], -1.0);
+        contribute(i, flipGate, 1.0);
+        double gain = before - localViolation(rowOf[i]);
+        contribute(i, flipGate, -1.0);
+        contribute(i, choice[i], 1.0);
+        return gain;
+    };
+
+    // c5 repair: for each violated window, repeatedly apply the height flip
+    // among its nodes that lowers the local violation the most. The window's
+    // flips are ranked once in a heap; since a flip changes the other gains,
+    // the top is re-evaluated before it is applied (lazy greedy), so a flip
+    // costs a heap operation instead of a rescan of the three rows.
+    const int maxPasses = 4;
+    const double minGain = 1e-9;
+    int numFlips = 0;
+    for (int pass=0; pass<maxPasses; ++pass) {
+        bool changed = false;
+        for (int r=0; r<numRows; ++r) {
+            if (violation(r) <= 0) continue;
+            priority_queue<pair<double, int>> flipQueue;
+            for (int q=r-1; q<=r+1; ++q) {
+                if (q < 0 || q >= numRows) continue;
+                for (int i : nodesOnRow[q]) {
+                    int k;
+                    double gain = flipGain(i, k);
+                    if (gain > minGain) flipQueue.push({gain, i});
+                } // for each intNode on row q
+            } // for each row q = r - 1, r, r + 1
+            while (violation(r) > 0 && !flipQueue.empty()) {
+                int i = flipQueue.top().second;
+                flipQueue.pop();
+                int k;
+                double gain = flipGain(i, k);
+                if (gain <= minGain) continue;
+                if (!flipQueue.empty() && gain < flipQueue.top().first) {
+                    flipQueue.push({gain, i});
+                    continue;
+                }
+                contribute(i, choice[i], -1.0);
+                contribute(i, k, 1.0);
+                choice[i] = k;
+                changed = true;
+                ++numFlips;
+            } // while row window r is violated
+        } // for each row
+        if (!changed) break;
+    } // for each repair pass
+
+    int numViolated = 0;
+    for (int r=0; r<numRows; ++r) {
+        if (violation(r) > 0) ++numViolated;
+    }
+
+    outFile << "# MIP start generated by NIMCHLegalizer" << endl;
+    for (size_t i=0; i<numNodes; ++i) {
+        const string& name = intNodeList[i]->getName();
+        for (size_t k=0; k<gateList[i].size(); ++k) {
+            outFile << "x[" << name << "][" << gateList[i][k]->getName() << "] "
+                    << ((int)k == choice[i] ? 1 : 0) << "\n";
+        }
+    }
+    outFile.close();
+
+    _writeLog("MIP start: " + to_string(numFlips) + " height flips, "
+              + to_string(numViolated) + " row windows still violated\n");
+    _writeSuccessLog("Gurobi MIP start generated\n");
+    return true;
+}
@@ -3,8 +3,8 @@
 #include <vector>
 #include <string>
 #include <sstream>
-#include <cmath>
 #include "legalizer/legalizer.h"
+#include "util/profiler.h"
 
 using namespace std;
 
@@ -26,261 +26,225 @@ Objective
     (o) minimize sum_{i in intNodes}{x[i][k] * area[k]}
 */
 
-bool Legalizer::_genGurobi() {
-    _writeLog("Generating the Gurobi model ...\n");
-
-    ofstream outFile("NIMCH_gurobi_c++.cpp");
-    if (!outFile.is_open()) {
-        cerr << "Error: Failed to open output file!" << endl;
-        return false;
-    }
+static const char* modelSource = R"(/*
+ * This file is generated by NIMCHLegalizer
+ */
 
-    outFile << "/*" << endl;
-    outFile << " * This file is generated by NIMCHLegalizer" << endl;
-    outFile << " */" << endl << endl;
-    outFile << "/*" << endl;
-    outFile << "Variables" << endl;
-    outFile << "    (v1) x[i][k] (k in gates(i))" << endl;
-    outFile << "        whether a libGate k is selected for an intNode i" << endl;
-    outFile << "    (v2) iAT[i]" << endl;
-    outFile << "        the output arrival time (oAT) of an intNode i" << endl;
-    outFile << "    (v3) oAT[i]" << endl;
-    outFile << "        the input arrival time (iAT) of an intNode i" << endl;
-    outFile << "Constraints" << endl;
-    outFile << "    (c1) sum_{k in gates(i)}x[i][k] == 1 for each intNode i" << endl;
-    outFile << "    (c2) iAT[i] == max_{j in fanins(i)}{oAT[j] + delay(j, i)} for each intNode/PO i" << endl;
-    outFile << "    (c3) oAT[i] == iAT[i] + sum_{k in gates(i)}{x[i][k] * delay(i, k)} for each intNode i" << endl;
-    outFile << "    (c4) oAT[i] <= maxDelay for each PO i" << endl;
-    outFile << "    (c5) gamma*W_chip <= sum_{i on {(r-1)-th, r-th, (r+1)-th} rows, k in gates(i) and height(k)==height(r)}{x[i][k] * width[k]} <= W_chip (0 < gamma < 1)" << endl;
-    outFile << "Objective" << endl;
-    outFile << "    (o) minimize sum_{i in intNodes}{x[i][k] * area[k]}" << endl;
-    outFile << "*/" << endl << endl;
-
-    outFile << "#include <iostream>" << endl;
-    outFile << "#include <cstring>" << endl;
-    outFile << "#include <fstream>" << endl;
-    outFile << "#include <unordered_map>" << endl;
-    outFile << "#include <vector>" << endl << endl;
-
-    outFile << "#include \"gurobi_c++.h\"" << endl;
-    outFile << "using namespace std;" << endl << endl;
-
-    outFile << "template <typename T>" << endl;
-    outFile << "using str2 = std::unordered_map<std::string, T>;" << endl << endl;
+/*
+Variables
+    (v1) x[i][k] (k in gates(i))
+        whether a libGate k is selected for an intNode i
+    (v2) iAT[i]
+        the output arrival time (oAT) of an intNode i
+    (v3) oAT[i]
+        the input arrival time (iAT) of an intNode i
+Constraints
+    (c1) sum_{k in gates(i)}x[i][k] == 1 for each intNode i
+    (c2) iAT[i] == max_{j in fanins(i)}{oAT[j] + delay(j, i)} for each intNode/PO i
+    (c3) oAT[i] == iAT[i] + sum_{k in gates(i)}{x[i][k] * delay(i, k)} for each intNode i
+    (c4) iAT[i] <= maxDelay for each PO i
+    (c5) gamma*W_chip <= sum_{i on {(r-1)-th, r-th, (r+1)-th} rows, k in gates(i) and height(k)==height(r)}{x[i][k] * width[k]} <= W_chip (0 < gamma < 1)
+Objective
+    (o) minimize sum_{i in intNodes}{x[i][k] * area[k]}
+The design is read from NIMCH_gurobi_model.txt (see _writeGurobiTables).
+*/
 
-    outFile << "int main() {" << endl;
-    outFile << "    try {" << endl;
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
 
-    outFile << "        ofstream outFile(\"NIMCH_gurobi_result.txt\");" << endl;
+#include "gurobi_c++.h"
+using namespace std;
 
-    outFile << "        GRBEnv env = GRBEnv(true);" << endl;
-    outFile << "        env.set(\"LogFile\", \"NIMCH_gurobi.log\");" << endl;
-    outFile << "        env.start();" << endl;
-    outFile << "        GRBModel model = GRBModel(env);" << endl << endl;
+struct Gate { string name; int height; double width, area; };
+struct Edge { int node; double delay; };    // node == -1: delay is an absolute arrival time
+struct Node {
+    string name;
+    int row, init;
+    vector<int> gate;
+    vector<double> delay;
+    vector<Edge> fanin;
+};
+
+int main() {
+    try {
+        ifstream inFile("NIMCH_gurobi_model.txt");
+        if (!inFile.is_open()) {
+            cerr << "Error: Failed to open NIMCH_gurobi_model.txt" << endl;
+            return 1;
+        }
+        string tag;
+        int version, numRows, numGates, numNodes, numPOs;
+        double chipWidth, gamma, maxDelay;
+        inFile >> tag >> version >> numRows >> chipWidth >> gamma >> maxDelay;
+        vector<int> rowHeight(numRows);
+        for (int& h : rowHeight) inFile >> h;
+        inFile >> numGates;
+        vector<Gate> gateList(numGates);
+        for (Gate& g : gateList) inFile >> g.name >> g.height >> g.width >> g.area;
+        inFile >> numNodes;
+        vector<Node> nodeList(numNodes);
+        for (Node& n : nodeList) {
+            int numCand, numFanin;
+            inFile >> n.name >> n.row >> n.init >> numCand;
+            n.gate.resize(numCand);
+            n.delay.resize(numCand);
+            for (int k = 0; k < numCand; ++k) inFile >> n.gate[k] >> n.delay[k];
+            inFile >> numFanin;
+            n.fanin.resize(numFanin);
+            for (Edge& e : n.fanin) inFile >> e.node >> e.delay;
+        }
+        inFile >> numPOs;
+        vector<vector<Edge>> poFanin(numPOs);
+        for (vector<Edge>& fanin : poFanin) {
+            int numFanin;
+            inFile >> numFanin;
+            fanin.resize(numFanin);
+            for (Edge& e : fanin) inFile >> e.node >> e.delay;
+        }
+        inFile.close();
+
+        GRBEnv env = GRBEnv(true);
+        env.set("LogFile", "NIMCH_gurobi.log");
+        env.start();
+        GRBModel model = GRBModel(env);
+
+        // (v1) x[i][k], (v2, v3) iAT[i], oAT[i]
+        vector<vector<GRBVar>> x(numNodes);
+        vector<GRBVar> iAT(numNodes), oAT(numNodes), poIAT(numPOs);
+        for (int i = 0; i < numNodes; ++i) {
+            const Node& n = nodeList[i];
+            for (int g : n.gate) {
+                x[i].push_back(model.addVar(0.0, 1.0, 0.0, GRB_BINARY,
+                                            "x[" + n.name + "][" + gateList[g].name + "]"));
+            }
+            iAT[i] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, "iAT[" + n.name + "]");
+            oAT[i] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, "oAT[" + n.name + "]");
+        }
+        for (int p = 0; p < numPOs; ++p) {
+            poIAT[p] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, "iAT[po" + to_string(p) + "]");
+        }
 
-    const auto& piList = _chip->netlist->getPIList();
-    const auto& intNodeList = _chip->netlist->getIntNodeList();
-    const auto& poList = _chip->netlist->getPOList();
-    double maxDelay = _chip->netlist->getMaxDelay(); 
-    int numRows = _chip->getNumRows(); 
-    double chipWidth = _chip->getBoundary().width();
+        // (c1), (c3) and the objective, one node at a time
+        GRBLinExpr areaSum = 0;
+        for (int i = 0; i < numNodes; ++i) {
+            const Node& n = nodeList[i];
+            GRBLinExpr xSum = 0, delaySum = 0;
+            for (size_t k = 0; k < n.gate.size(); ++k) {
+                xSum += x[i][k];
+                delaySum += x[i][k] * n.delay[k];
+                areaSum += x[i][k] * gateList[n.gate[k]].area;
+            }
+            model.addConstr(xSum == 1, "c1[" + n.name + "]");
+            model.addConstr(oAT[i] == iAT[i] + delaySum, "c3[" + n.name + "]");
+        }
 
-    // Output node and gate information
-    outFile << "        // Node and Gate Information" << endl;
-    outFile << "        vector<string> piList = {\"" << piList[0]->getName() << "\"";
-    for (size_t i=1; i<piList.size(); ++i) {
-        outFile << ", \"" << piList[i]->getName() << "\"";
-    }
-    outFile << "};" << endl;
-    outFile << "        vector<string> intNodeList = {\"" << intNodeList[0]->getName() << "\"";
-    for (size_t i=1; i<intNodeList.size(); ++i) {
-        outFile << ", \"" << intNodeList[i]->getName() << "\"";
-    }
-    outFile << "};" << endl;
-    outFile << "        vector<string> poList = {\"" << poList[0]->getName() << "\"";
-    for (size_t i=1; i<poList.size(); ++i) {
-        outFile << ", \"" << poList[i]->getName() << "\"";
-    }
-    outFile << "};" << endl;
-    outFile << "        str2<vector<string>> gateList = {" << endl;
-    for (const auto& intNode : intNodeList) {
-        vector<sPtr<LibGate>> libGateList = _gateLibrary->getLibGateList(intNode->getLogic());
-        outFile << "            {\"" << intNode->getName() << "\", {\"" << libGateList[0]->getName() << "\"";
-        for (size_t i=1; i<libGateList.size(); ++i) {
-            outFile << ", \"" << libGateList[i]->getName() << "\"";
+        // (c2) for each fanin edge of an intNode or PO
+        auto addFanin = [&](const GRBVar& iATVar, const vector<Edge>& fanin, const string& name) {
+            for (size_t f = 0; f < fanin.size(); ++f) {
+                const Edge& e = fanin[f];
+                string constrName = "c2[" + name + "][" + to_string(f) + "]";
+                if (e.node == -1) model.addConstr(iATVar >= e.delay, constrName);
+                else model.addConstr(iATVar >= oAT[e.node] + e.delay, constrName);
+            }
+        };
+        for (int i = 0; i < numNodes; ++i) addFanin(iAT[i], nodeList[i].fanin, nodeList[i].name);
+        for (int p = 0; p < numPOs; ++p) addFanin(poIAT[p], poFanin[p], "po" + to_string(p));
+
+        // (c4)
+        for (int p = 0; p < numPOs; ++p) {
+            model.addConstr(poIAT[p] <= maxDelay, "c4[po" + to_string(p) + "]");
         }
-        outFile << "}}," << endl;
-    }
-    outFile << "        };" << endl << endl;
 
+        // (c5) each node contributes to the windows of rows row-1..row+1
+        vector<GRBLinExpr> widthSum(numRows, 0);
+        for (int i = 0; i < numNodes; ++i) {
+            const Node& n = nodeList[i];
+            for (int r = max(0, n.row - 1); r <= min(numRows - 1, n.row + 1); ++r) {
+                for (size_t k = 0; k < n.gate.size(); ++k) {
+                    const Gate& g = gateList[n.gate[k]];
+                    if (g.height == rowHeight[r]) widthSum[r] += x[i][k] * g.width;
+                }
+            }
+        }
+        for (int r = 0; r < numRows; ++r) {
+            model.addConstr(widthSum[r] >= gamma * chipWidth, "c5[" + to_string(r) + "][lower]");
+            model.addConstr(widthSum[r] <= chipWidth, "c5[" + to_string(r) + "][upper]");
+        }
 
-// Variables
-    // (v1) x[i][k]
-    outFile << "        // (v1) x[i][k]" << endl;
-    outFile << "        str2<str2<GRBVar>> x;" << endl;
-    outFile << "        for (const auto& intNode : intNodeList) {" << endl;
-    outFile << "            for (const auto& gate : gateList[intNode]) {" << endl;
-    outFile << "                string x_i_k = \"x[\" + intNode + \"][\" + gate + \"]\";" << endl;
-    outFile << "                x[intNode][gate] = model.addVar(0.0, 1.0, 0.0, GRB_BINARY, x_i_k);" << endl;
-    outFile << "            } // for each libGate whose logic matches intNode" << endl;
-    outFile << "        } // for each intNode" << endl << endl;
+        // (o)
+        model.setObjective(areaSum, GRB_MINIMIZE);
 
-    // (v2, v3) iAT[i], oAT[i]
-    outFile << "        // (v2, v3) iAT[i], oAT[i]" << endl;
-    outFile << "        str2<GRBVar> iAT, oAT;" << endl;
-    outFile << "        for (const auto& intNode : intNodeList) {" << endl;
-    outFile << "            string iAT_i = \"iAT[\" + intNode + \"]\";" << endl;
-    outFile << "            string oAT_i = \"oAT[\" + intNode + \"]\";" << endl;
-    outFile << "            iAT[intNode] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, iAT_i);" << endl;
-    outFile << "            oAT[intNode] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, oAT_i);" << endl;
-    outFile << "        } // for each internal node" << endl;
-    outFile << "        for (const auto& poNode : poList) {" << endl;
-    outFile << "            string iAT_i = \"iAT[\" + poNode + \"]\";" << endl;
-    outFile << "            iAT[poNode] = model.addVar(0.0, 0.0, 0.0, GRB_CONTINUOUS, iAT_i);" << endl;
-    outFile << "        } // for each PO node" << endl << endl;
+        // MIP start from the input DEF's gate assignment (see _genGurobiMipStart)
+        if (ifstream("NIMCH_gurobi.mst").good()) {
+            model.update();
+            model.read("NIMCH_gurobi.mst");
+        }
 
-// Constraints
-    outFile << "        std::string constraint;" << endl;
-    outFile << "        int count;" << endl;
-    outFile << "        char constrName[32];" << endl << endl;
+        model.optimize();
 
-    // (c1) sum_{k in gates(i)}x[i][k] == 1 for each intNode i
-    outFile << "        count = 0;" << endl;
-    outFile << "        // (c1) sum_{k in gates(i)}x[i][k] == 1 for each intNode i" << endl;
-    outFile << "        GRBLinExpr xSum;" << endl;
-    outFile << "        for (const auto& intNode : intNodeList) {" << endl;
-    outFile << "            xSum = 0;" << endl;
-    outFile << "            for (const auto& gate : gateList[intNode]) {" << endl;
-    outFile << "                xSum += x[intNode][gate];" << endl;
-    outFile << "            } // for each libGate whose logic matches intNode" << endl;
-    outFile << "            strcpy(constrName, (\"c1[\" + intNode + \"]\").c_str());" << endl;
-    outFile << "            cout << constrName << endl;" << endl;
-    outFile << "            model.addConstr(xSum == 1, constrName);" << endl;
-    outFile << "        } // for each intNode" << endl << endl;
+        // Output Results; without an incumbent there is nothing to write, and
+        // a result file left by an earlier run must not be applied either
+        if (model.get(GRB_IntAttr_SolCount) == 0) {
+            cerr << "No gate assignment found, no result written" << endl;
+            remove("NIMCH_gurobi_result.txt");
+            return 0;
+        }
+        ofstream outFile("NIMCH_gurobi_result.txt");
+        for (int i = 0; i < numNodes; ++i) {
+            for (size_t k = 0; k < x[i].size(); ++k) {
+                if (x[i][k].get(GRB_DoubleAttr_X) > 0.5) {
+                    outFile << nodeList[i].name << " " << gateList[nodeList[i].gate[k]].name << "\n";
+                    break;
+                }
+            }
+        }
 
-    std::string constraint;
-    
-    // (c2) iAT[i] == max_{j in fanins(i)}{oAT[j] + delay(j, i)} for each intNode/PO i
-    outFile << "        // (c2) iAT[i] == max_{j in fanins(i)}{oAT[j] + delay(j, i)} for each intNode/PO i" << endl;
-    for (sPtr<IntNode> intNode : intNodeList) {
-        std::string iAT_i = "iAT[\"" + intNode->getName() + "\"]";
-        for (std::string iWireName : intNode->getInWireList()) {
-            sPtr<Node> iNode = _chip->netlist->getWire(iWireName)->getInNode();
-            std::string oAT_j;
-            if (iNode->isInternal()) {
-                sPtr<IntNode> intNode = _chip->netlist->getIntNode(iNode->getName());
-                oAT_j = "oAT[\"" + intNode->getName() + "\"]";
-            } // if iNode is internal
-            else if (iNode->isPI()) {
-                sPtr<PINode> piNode = _chip->netlist->getPI(iNode->getName());
-                oAT_j = to_string(piNode->getOAT());
-            } // if iNode is PI
-            else {
-                _writeErrorLog("Error: iNode is neither internal nor PI!\n");
-                return false;
-            } // if iNode is neither internal nor PI (impossible)
-            std::string delay_j_i = to_string(_chip->netlist->getWire(iWireName)->getDelay());
-            constraint = iAT_i + " >= " + oAT_j + " + " + delay_j_i;
-            outFile << "        model.addConstr(" << constraint
-                    << ", \"c2[" << intNode->getName() << "][" << iNode->getName() << "]\");" << endl;
-        } // for each input wire of intNode
-    } // for each intNode
-    outFile << endl;
+        outFile.close();
 
-    // (c3) oAT[i] == iAT[i] + sum_{k in gates(i)}{x[i][k] * delay(i, k)} for each intNode i
-    outFile << "        // (c3) oAT[i] == iAT[i] + sum_{k in gates(i)}{x[i][k] * delay(i, k)} for each intNode i" << endl;
-    outFile << "        GRBLinExpr delaySum;" << endl;
-    for (sPtr<IntNode> intNode : intNodeList) {
-        std::string iAT_i = "iAT[\"" + intNode->getName() + "\"]";
-        std::string oAT_i = "oAT[\"" + intNode->getName() + "\"]";
-        outFile << "        delaySum = 0;" << endl;
-        for (sPtr<LibGate> libGate : _gateLibrary->getLibGateList(intNode->getLogic())) {
-            std::string x_i_k = "x[\"" + intNode->getName() + "\"][\"" + libGate->getName() + "\"]";
-            std::string delay_i_k = to_string(intNode->getDelay(libGate->getName()));
-            outFile << "        delaySum += " << x_i_k << " * " << delay_i_k << ";" << endl;
-        } // for each libGate whose logic matches intNode
-        constraint = oAT_i + " == " + iAT_i + " + delaySum";
-        outFile << "        model.addConstr(" << constraint << ", \"c3[" << intNode->getName() << "]\");" << endl;
-    } // for each intNode
-    outFile << endl;
+    } catch (GRBException e) {
+        cerr << "Error code = " << e.getErrorCode() << endl;
+        cerr << e.getMessage() << endl;
+    } catch (...) {
+        cerr << "Exception during optimization" << endl;
+    }
 
-    // (c4) iAT[i] <= maxDelay for each PO i
-    outFile << "        // (c4) iAT[i] <= maxDelay for each PO i" << endl;
-    for (sPtr<PONode> poNode : poList) {
-        std::string iAT_i = "iAT[\"" + poNode->getName() + "\"]";
-        constraint = iAT_i + " <= " + to_string(maxDelay);
-        outFile << "        model.addConstr(" << constraint << ", \"c4[" << poNode->getName() << "]\");" << endl;
-    } // for each PO node
-    outFile << endl;
+    return 0;
+}
+)";
 
-    // (c5) gamma*W_chip <= sum_{i on {(r-1)-th, r-th, (r+1)-th} rows, k in gates(i) and height(k)==height(r)}{x[i][k] * width[k]} <= W_chip (0 < gamma < 1)
-    outFile << "        // (c5) gamma*W_chip <= sum_{i on {(r-1)-th, r-th, (r+1)-th} rows, k in gates(i) and height(k)==height(r)}{x[i][k] * width[k]} <= W_chip (0 < gamma < 1)" << endl;
-    const std::string gamma = "0.9";
-    outFile << "        GRBLinExpr widthSum;" << endl;
-    for (int r = 0; r < numRows; ++r) {
-        outFile << "        widthSum = 0;" << endl;
-        LibGate::height height = _chip->isRowShort(r) ? LibGate::height::SHORT : LibGate::height::TALL;
-        for (int nearestRow=(r-1); nearestRow<=(r+1); ++nearestRow) {
-            if (nearestRow >= 0 && nearestRow < numRows) {
-                for (sPtr<IntNode> intNode : _chip->getNodesOnRow(nearestRow)) {
-                    for (sPtr<LibGate> libGate : _gateLibrary->getLibGateList(intNode->getLogic())) {
-                        if (libGate->getHeight() == height) {
-                            std::string x_i_k = "x[\"" + intNode->getName() + "\"][\"" + libGate->getName() + "\"]";
-                            std::string width_k = to_string(libGate->getBoundary().width());
-                            outFile << "        widthSum" << " += " << x_i_k << " * " << width_k << ";" << endl;
-                        } // if libGate height matches row height
-                    } // for each libGate whose logic matches intNode
-                } // for each intNode on nearestRow
-            } // if nearestRow is valid
-        } // for each nearestRow = row - 1, row, row + 1
-        constraint = "widthSum >= " + gamma + " * " + to_string(chipWidth);
-        outFile << "        model.addConstr(" << constraint << ", \"c5[" << r << "][upper]\");" << endl;
-        constraint = "widthSum <= " + to_string(chipWidth);
-        outFile << "        model.addConstr(" << constraint << ", \"c[" << r << "][lower]\");" << endl;
-    } // for each row
-    outFile << endl;
+bool Legalizer::_genGurobi() {
+    PROFILE_SCOPE("genGurobi");
+    _writeLog("Generating the Gurobi model ...\n");
 
-// Objective
-    // (o) minimize sum_{i in intNodes}{x[i][k] * area[k]}
-    outFile << "        // (o) minimize sum_{i in intNodes}{x[i][k] * area[k]}" << endl;
-    outFile << "        GRBLinExpr areaSum = 0;" << endl;
-    for (sPtr<IntNode> intNode : intNodeList) {
-        const auto& gateList = _gateLibrary->getLibGateList(intNode->getLogic());
-        for (sPtr<LibGate> gate : gateList) {
-            std::string x_i_k = "x[\"" + intNode->getName() + "\"][\"" + gate->getName() + "\"]";
-            std::string area_k = to_string(gate->getBoundary().area());
-            outFile << "        areaSum += " << x_i_k << " * " << area_k << ";" << endl;
-        }
+    ofstream outFile("NIMCH_gurobi_c++.cpp");
+    if (!outFile.is_open()) {
+        cerr << "Error: Failed to open output file!" << endl;
+        return false;
     }
-    outFile << "        model.setObjective(areaSum, GRB_MINIMIZE);" << endl << endl;
+    outFile << modelSource;
+    outFile.close();
 
-    outFile << "        model.optimize();" << endl << endl;
-    
-    // TODO: write the optimization result to the output file "NIMCH_gurobi_result.txt"
-    outFile << "        // Output Results" << endl;
-    outFile << "        for (const auto& intNode : intNodeList) {" << endl;
-    outFile << "            for (const auto& gate : gateList[intNode]) {" << endl;
-    outFile << "                if (x[intNode][gate].get(GRB_DoubleAttr_X) > 0.5) {" << endl;
-    outFile << "                    outFile << intNode << \" \" << gate << endl;" << endl;
-    outFile << "                    break;" << endl;
-    outFile << "                }" << endl;
-    outFile << "            }" << endl;
-    outFile << "        }" << endl << endl;
-    
-    outFile << "        outFile.close();" << endl << endl;
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
+    int numRows = _chip->getNumRows();
+    double chipWidth = _chip->getBoundary().width();
+    const double gamma = _gamma;
 
-    outFile << "    } catch (GRBException e) {" << endl;
-    outFile << "        cerr << \"Error code = \" << e.getErrorCode() << endl;" << endl;
-    outFile << "        cerr << e.getMessage() << endl;" << endl;
-    outFile << "    } catch (...) {" << endl;
-    outFile << "        cerr << \"Exception during optimization\" << endl;" << endl;
-    outFile << "    }" << endl << endl;
+    ostringstream header;
+    header.precision(10);
+    header << "NIMCH_MODEL 1 " << numRows << " " << chipWidth << " " << gamma << " " << maxDelay << "\n";
+    if (!_writeGurobiTables("NIMCH_gurobi_model.txt", header.str())) return false;
+    PROFILE_COUNT("constraints/c1", _chip->netlist->getIntNodeList().size());
+    PROFILE_COUNT("constraints/c4", _chip->netlist->getPOList().size());
+    PROFILE_COUNT("constraints/c5", 2 * numRows);
 
-    outFile << "    return 0;" << endl;
-    outFile << "}" << endl;
+    // MIP start from the input DEF's gate assignment; the program reads it if present
+    _genGurobiMipStart(gamma);
+    // Reference point for the next ECO run once the result is applied (see _genGurobiEco)
+    if (!_writeEcoSnapshot("NIMCH_eco_snapshot.txt")) return false;
 
-    outFile.close();
-    
     _writeSuccessLog("Gurobi model generated\n");
     return true;
 }
\ No newline at end of file
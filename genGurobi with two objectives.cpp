@@ -5,9 +5,135 @@
 #include <sstream>
 #include <cmath>
 #include "legalizer/legalizer.h"
+#include "util/ptrSpan.h"
+#include "physical/rowIndex.h"
 
 using namespace std;
 
+/*
+Pareto sweep (generated program run as `NIMCH_gurobi --sweep <sweep file>`)
+    The model is built once and written to NIMCH_gurobi_sweep.mps. Every
+    (gamma, maxDelay) pair is a chain over the sorted alpha values; chains are
+    split into segments to fill all cores, each segment is solved on its own
+    thread and Gurobi env, and every alpha warm-starts from the previous
+    alpha's solution in the same segment. Only the objective coefficients and
+    the c4 / c5 right-hand sides change between solves.
+Sweep file
+    alpha <a1> <a2> ...
+    gamma <g1> <g2> ...          (optional, default: the generated gamma)
+    maxDelay <d1> <d2> ...       (optional, default: the generated maxDelay)
+Output: NIMCH_gurobi_pareto.csv
+*/
+static const char* paretoSweepSource = R"(struct SweepPoint {
+    double alpha, gamma, maxDelay;
+    int status;
+    double costArea, costHdiff, runtime;
+    bool pareto;
+};
+
+void paretoSweep(GRBModel& model, const string& sweepFile,
+                 const GRBLinExpr& areaSum, double areaScale,
+                 const GRBLinExpr& heightMismatchSum, double hdiffScale,
+                 const vector<GRBConstr>& c4List, const vector<GRBConstr>& c5LowerList, double chipWidth) {
+    model.update();
+    vector<double> alphaList, gammaList, maxDelayList;
+    ifstream inFile(sweepFile);
+    string line, key;
+    while (getline(inFile, line)) {
+        istringstream ss(line);
+        ss >> key;
+        vector<double>* list = (key == "alpha") ? &alphaList
+                             : (key == "gamma") ? &gammaList
+                             : (key == "maxDelay") ? &maxDelayList : nullptr;
+        for (double v; list && ss >> v; ) list->push_back(v);
+    }
+    if (alphaList.empty()) alphaList.push_back(0.5);
+    if (gammaList.empty()) gammaList.push_back(c5LowerList.empty() ? 0.0 : c5LowerList[0].get(GRB_DoubleAttr_RHS) / chipWidth);
+    if (maxDelayList.empty()) maxDelayList.push_back(c4List.empty() ? 0.0 : c4List[0].get(GRB_DoubleAttr_RHS));
+    sort(alphaList.begin(), alphaList.end());
+
+    int numVars = model.get(GRB_IntAttr_NumVars);
+    vector<double> areaCoef(numVars, 0.0), hdiffCoef(numVars, 0.0);
+    for (unsigned i = 0; i < areaSum.size(); ++i) areaCoef[areaSum.getVar(i).index()] += areaSum.getCoeff(i) * areaScale;
+    for (unsigned i = 0; i < heightMismatchSum.size(); ++i) hdiffCoef[heightMismatchSum.getVar(i).index()] += heightMismatchSum.getCoeff(i) * hdiffScale;
+    vector<int> c4Idx, c5Idx;
+    for (const GRBConstr& c : c4List) c4Idx.push_back(c.index());
+    for (const GRBConstr& c : c5LowerList) c5Idx.push_back(c.index());
+    model.write("NIMCH_gurobi_sweep.mps");
+
+    size_t numAlpha = alphaList.size(), numGamma = gammaList.size(), numMaxDelay = maxDelayList.size();
+    size_t numChains = numGamma * numMaxDelay;
+    unsigned numThreads = max(1u, thread::hardware_concurrency());
+    size_t segPerChain = max<size_t>(1, min(numAlpha, (numThreads + numChains - 1) / numChains));
+    size_t segLen = (numAlpha + segPerChain - 1) / segPerChain;
+    vector<array<size_t, 3>> taskList;   // (chain, alpha begin, alpha end)
+    for (size_t c = 0; c < numChains; ++c) {
+        for (size_t a = 0; a < numAlpha; a += segLen) taskList.push_back({c, a, min(numAlpha, a + segLen)});
+    }
+    int threadsPerSolve = max<int>(1, numThreads / taskList.size());
+    numThreads = min<size_t>(numThreads, taskList.size());
+
+    vector<SweepPoint> pointList(numChains * numAlpha);
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        GRBEnv env(true);
+        env.set(GRB_IntParam_OutputFlag, 0);
+        env.set(GRB_IntParam_Threads, threadsPerSolve);
+        env.start();
+        for (size_t t; (t = next++) < taskList.size(); ) {
+            size_t c = taskList[t][0];
+            double gamma = gammaList[c / numMaxDelay], maxDelay = maxDelayList[c % numMaxDelay];
+            GRBModel m(env, "NIMCH_gurobi_sweep.mps");
+            GRBVar* vars = m.getVars();
+            GRBConstr* constrs = m.getConstrs();
+            for (int i : c4Idx) constrs[i].set(GRB_DoubleAttr_RHS, maxDelay);
+            for (int i : c5Idx) constrs[i].set(GRB_DoubleAttr_RHS, gamma * chipWidth);
+            vector<double> obj(numVars);
+            for (size_t a = taskList[t][1]; a < taskList[t][2]; ++a) {
+                double alpha = alphaList[a];
+                for (int j = 0; j < numVars; ++j) obj[j] = alpha * areaCoef[j] + (1 - alpha) * hdiffCoef[j];
+                m.set(GRB_DoubleAttr_Obj, vars, obj.data(), numVars);
+                m.optimize();
+                SweepPoint& p = pointList[c * numAlpha + a];
+                p = {alpha, gamma, maxDelay, m.get(GRB_IntAttr_Status), NAN, NAN, m.get(GRB_DoubleAttr_Runtime), false};
+                if (m.get(GRB_IntAttr_SolCount) > 0) {
+                    double* x = m.get(GRB_DoubleAttr_X, vars, numVars);
+                    p.costArea = p.costHdiff = 0;
+                    for (int j = 0; j < numVars; ++j) {
+                        p.costArea += areaCoef[j] * x[j];
+                        p.costHdiff += hdiffCoef[j] * x[j];
+                    }
+                    m.set(GRB_DoubleAttr_Start, vars, x, numVars);   // warm start for the next alpha
+                    delete[] x;
+                }
+            }
+            delete[] vars;
+            delete[] constrs;
+        }
+    };
+    vector<thread> threadList;
+    for (unsigned t = 0; t < numThreads; ++t) threadList.emplace_back(worker);
+    for (thread& th : threadList) th.join();
+
+    ofstream csvFile("NIMCH_gurobi_pareto.csv");
+    csvFile << "alpha,gamma,maxDelay,status,Cost_area,Cost_hdiff,runtime,pareto" << endl;
+    for (size_t c = 0; c < numChains; ++c) {
+        for (size_t a = 0; a < numAlpha; ++a) {
+            SweepPoint& p = pointList[c * numAlpha + a];
+            p.pareto = !isnan(p.costArea);
+            for (size_t b = 0; b < numAlpha && p.pareto; ++b) {
+                const SweepPoint& q = pointList[c * numAlpha + b];
+                if (!isnan(q.costArea) && q.costArea <= p.costArea && q.costHdiff <= p.costHdiff
+                    && (q.costArea < p.costArea || q.costHdiff < p.costHdiff)) p.pareto = false;
+            }
+            csvFile << p.alpha << "," << p.gamma << "," << p.maxDelay << "," << p.status << ","
+                    << p.costArea << "," << p.costHdiff << "," << p.runtime << "," << p.pareto << endl;
+        }
+    }
+}
+
+)";
+
 bool Legalizer::_genGurobi() {
     _writeInfoMsg("Generating the Gurobi model ...\n");
 
@@ -17,9 +143,15 @@ bool Legalizer::_genGurobi() {
         return false;
     }
 
+    outFile << "#include <algorithm>" << endl;
+    outFile << "#include <array>" << endl;
+    outFile << "#include <atomic>" << endl;
+    outFile << "#include <cmath>" << endl;
     outFile << "#include <iostream>" << endl;
     outFile << "#include <cstring>" << endl;
     outFile << "#include <fstream>" << endl;
+    outFile << "#include <sstream>" << endl;
+    outFile << "#include <thread>" << endl;
     outFile << "#include <unordered_map>" << endl;
     outFile << "#include <vector>" << endl << endl;
 
@@ -29,7 +161,9 @@ bool Legalizer::_genGurobi() {
     outFile << "template <typename T>" << endl;
     outFile << "using str2 = std::unordered_map<std::string, T>;" << endl << endl;
 
-    outFile << "int main() {" << endl;
+    outFile << paretoSweepSource;
+
+    outFile << "int main(int argc, char** argv) {" << endl;
     outFile << "    try {" << endl;
 
     outFile << "        ofstream outFile(\"NIMCH_gurobi_result.txt\");" << endl;
@@ -42,7 +176,7 @@ bool Legalizer::_genGurobi() {
     const auto& piList = _chip->netlist->getPIList();
     const auto& intNodeList = _chip->netlist->getIntNodeList();
     const auto& poList = _chip->netlist->getPOList();
-    double maxDelay = _chip->netlist->getMaxDelay(); 
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
     int numRows = _chip->getNumRows(); 
     double chipWidth = _chip->getBoundary().width();
     double chipheight = _chip->getBoundary().height();
@@ -66,7 +200,7 @@ bool Legalizer::_genGurobi() {
     outFile << "};" << endl;
     outFile << "        str2<vector<string>> gateList = {" << endl;
     for (const auto& intNode : intNodeList) {
-        vector<sPtr<LibGate>> libGateList = _gateLibrary->getLibGateList(intNode->getLogic());
+        PtrSpan<LibGate> libGateList = _getCandidateGates(intNode);
         outFile << "            {\"" << intNode->getName() << "\", {\"" << libGateList[0]->getName() << "\"";
         for (size_t i=1; i<libGateList.size(); ++i) {
             outFile << ", \"" << libGateList[i]->getName() << "\"";
@@ -92,7 +226,7 @@ bool Legalizer::_genGurobi() {
     outFile << "        } // for each internal node" << endl;
     outFile << "        for (const auto& poNode : poList) {" << endl;
     outFile << "            string iAT_i = \"iAT[\" + poNode + \"]\";" << endl;
-    outFile << "            iAT[poNode] = model.addVar(0.0, 0.0, 0.0, GRB_CONTINUOUS, iAT_i);" << endl;
+    outFile << "            iAT[poNode] = model.addVar(0.0, GRB_INFINITY, 0.0, GRB_CONTINUOUS, iAT_i);" << endl;
     outFile << "        } // for each PO node" << endl << endl;
 
     outFile << "        std::string constraint;" << endl;
@@ -112,39 +246,62 @@ bool Legalizer::_genGurobi() {
 
     std::string constraint;
     
-    for (sPtr<IntNode> intNode : intNodeList) {
+    if (!_buildFaninTable()) return false;
+    for (size_t i=0; i<intNodeList.size(); ++i) {
+        const sPtr<IntNode>& intNode = intNodeList[i];
         std::string iAT_i = "iAT[\"" + intNode->getName() + "\"]";
-        for (std::string iWireName : intNode->getInWireList()) {
-            sPtr<Node> iNode = _chip->netlist->getWire(iWireName)->getInNode();
-            std::string oAT_j;
-            if (iNode->isInternal()) {
-                sPtr<IntNode> intNode = _chip->netlist->getIntNode(iNode->getName());
-                oAT_j = "oAT[\"" + intNode->getName() + "\"]";
+        for (int f=_faninOffset[i]; f<_faninOffset[i + 1]; ++f) {
+            int w = _faninWire[f];
+            std::string oAT_j, iNodeName;
+            if (_wireSource[w] != -1) {
+                iNodeName = intNodeList[_wireSource[w]]->getName();
+                oAT_j = "oAT[\"" + iNodeName + "\"]";
             } // if iNode is internal
-            else if (iNode->isPI()) {
-                sPtr<PINode> piNode = _chip->netlist->getPI(iNode->getName());
-                oAT_j = to_string(piNode->getOAT());
-            } // if iNode is PI
             else {
-                _writeErrorMsg("Error: iNode is neither internal nor PI!\n");
-                return false;
-            } // if iNode is neither internal nor PI (impossible)
-            std::string delay_j_i = to_string(_chip->netlist->getWire(iWireName)->getDelay());
+                iNodeName = _chip->netlist->getWire(intNode->getInWireList()[f - _faninOffset[i]])->getInNode()->getName();
+                oAT_j = to_string(_wireArrival[w]);
+            } // if iNode is PI
+            std::string delay_j_i = to_string(_wireDelay[w]);
             constraint = iAT_i + " >= " + oAT_j + " + " + delay_j_i;
             outFile << "        model.addConstr(" << constraint
-                    << ", \"c2[" << intNode->getName() << "][" << iNode->getName() << "]\");" << endl;
+                    << ", \"c2[" << intNode->getName() << "][" << iNodeName << "]\");" << endl;
         } // for each input wire of intNode
     } // for each intNode
+    for (size_t p=0; p<poList.size(); ++p) {
+        const sPtr<PONode>& poNode = poList[p];
+        std::string iAT_i = "iAT[\"" + poNode->getName() + "\"]";
+        for (int f=_poFaninOffset[p]; f<_poFaninOffset[p + 1]; ++f) {
+            int w = _poFaninWire[f];
+            std::string oAT_j, iNodeName;
+            if (_wireSource[w] != -1) {
+                iNodeName = intNodeList[_wireSource[w]]->getName();
+                oAT_j = "oAT[\"" + iNodeName + "\"]";
+            } // if iNode is internal
+            else {
+                iNodeName = _chip->netlist->getWire(poNode->getInWireList()[f - _poFaninOffset[p]])->getInNode()->getName();
+                oAT_j = to_string(_wireArrival[w]);
+            } // if iNode is PI
+            std::string delay_j_i = to_string(_wireDelay[w]);
+            constraint = iAT_i + " >= " + oAT_j + " + " + delay_j_i;
+            outFile << "        model.addConstr(" << constraint
+                    << ", \"c2[" << poNode->getName() << "][" << iNodeName << "]\");" << endl;
+        } // for each input wire of poNode
+    } // for each PO node
     outFile << endl;
 
     outFile << "        GRBLinExpr delaySum;" << endl;
-    for (sPtr<IntNode> intNode : intNodeList) {
+    for (size_t i=0; i<intNodeList.size(); ++i) {
+        const sPtr<IntNode>& intNode = intNodeList[i];
         std::string iAT_i = "iAT[\"" + intNode->getName() + "\"]";
         std::string oAT_i = "oAT[\"" + intNode->getName() + "\"]";
+        const double* delay = _delayArena.data() + _delayOffset[i];
         outFile << "        delaySum = 0;" << endl;
-        for (sPtr<LibGate> libGate : _gateLibrary->getLibGateList(intNode->getLogic())) {
+        PtrSpan<LibGate> candGates = _getCandidateGates(intNode);
+        const vector<int>& candIdx = _getCandidateGateIdx(intNode);
+        for (size_t c=0; c<candGates.size(); ++c) {
+            LibGate* libGate = candGates[c];
             std::string x_i_k = "x[\"" + intNode->getName() + "\"][\"" + libGate->getName() + "\"]";
-            std::string delay_i_k = to_string(intNode->getDelay(libGate->getName()));
+            std::string delay_i_k = to_string(delay[candIdx[c]]);
             outFile << "        delaySum += " << x_i_k << " * " << delay_i_k << ";" << endl;
         } // for each libGate whose logic matches intNode
         constraint = oAT_i + " == " + iAT_i + " + delaySum";
@@ -152,22 +309,43 @@ bool Legalizer::_genGurobi() {
     } // for each intNode
     outFile << endl;
 
-    for (sPtr<PONode> poNode : poList) {
+    outFile << "        vector<GRBConstr> c4List, c5LowerList;" << endl;
+    for (PONode* poNode : ptrSpan(poList)) {
         std::string iAT_i = "iAT[\"" + poNode->getName() + "\"]";
         constraint = iAT_i + " <= " + to_string(maxDelay);
-        outFile << "        model.addConstr(" << constraint << ", \"c4[" << poNode->getName() << "]\");" << endl;
+        outFile << "        c4List.push_back(model.addConstr(" << constraint << ", \"c4[" << poNode->getName() << "]\"));" << endl;
     } // for each PO node
     outFile << endl;
 
-    const std::string gamma = "0.9";
+    // Row membership comes from the chip's row index; its node indices (into
+    // chip->nodeList()) are mapped to intNodes once. A row or component the
+    // netlist does not know would silently drop c5 terms, so both are errors.
+    const RowIndex& rowIndex = chip->rowIndex();
+    if (rowIndex.numRows() != numRows) {
+        _writeErrorLog("Error: The DEF has " + to_string(rowIndex.numRows()) + " rows but the netlist has "
+                       + to_string(numRows) + "!\n");
+        return false;
+    }
+    vector<int> intNodeOf(chip->nodeList().size(), -1);
+    for (size_t v=0; v<chip->nodeList().size(); ++v) {
+        auto it = _intNodeIdx.find(chip->nodeList()[v]->name());
+        if (it == _intNodeIdx.end()) {
+            _writeErrorLog("Error: Component " + chip->nodeList()[v]->name() + " is not an intNode!\n");
+            return false;
+        }
+        intNodeOf[v] = it->second;
+    }
+
+    const std::string gamma = to_string(_gamma);
     outFile << "        GRBLinExpr widthSum;" << endl;
     for (int r = 0; r < numRows; ++r) {
         outFile << "        widthSum = 0;" << endl;
         LibGate::height height = _chip->isRowShort(r) ? LibGate::height::SHORT : LibGate::height::TALL;
         for (int nearestRow=(r-1); nearestRow<=(r+1); ++nearestRow) {
             if (nearestRow >= 0 && nearestRow < numRows) {
-                for (sPtr<IntNode> intNode : _chip->getNodesOnRow(nearestRow)) {
-                    for (sPtr<LibGate> libGate : _gateLibrary->getLibGateList(intNode->getLogic())) {
+                for (auto [it, end] = rowIndex.nodesOnRow(nearestRow); it != end; ++it) {
+                    const sPtr<IntNode>& intNode = intNodeList[intNodeOf[*it]];
+                    for (LibGate* libGate : ptrSpan(_getCandidateGates(intNode))) {
                         if (libGate->getHeight() == height) {
                             std::string x_i_k = "x[\"" + intNode->getName() + "\"][\"" + libGate->getName() + "\"]";
                             std::string width_k = to_string(libGate->getBoundary().width());
@@ -178,7 +356,7 @@ bool Legalizer::_genGurobi() {
             } // if nearestRow is valid
         } // for each nearestRow = row - 1, row, row + 1
         constraint = "widthSum >= " + gamma + " * " + to_string(chipWidth);
-        outFile << "        model.addConstr(" << constraint << ", \"c5[" << r << "][upper]\");" << endl;
+        outFile << "        c5LowerList.push_back(model.addConstr(" << constraint << ", \"c5[" << r << "][upper]\"));" << endl;
         constraint = "widthSum <= " + to_string(chipWidth);
         outFile << "        model.addConstr(" << constraint << ", \"c[" << r << "][lower]\");" << endl;
     } // for each row
@@ -186,13 +364,14 @@ bool Legalizer::_genGurobi() {
 
 // Objective
     // (o) minimize alpha*Cost_area + (1-alpha)*Cost_hdiff
-    outFile << "        double alpha = 0.5;" << endl;
+    outFile << "        double alpha = " << _alpha << ";" << endl;
+    outFile << "        GRBLinExpr Cost_area, Cost_hdiff;" << endl;
 
     outFile << "        // (o) alpha*Cost_area" << endl;
     outFile << "        GRBLinExpr areaSum = 0;" << endl;
-    for (sPtr<IntNode> intNode : intNodeList) {
-        const auto& gateList = _gateLibrary->getLibGateList(intNode->getLogic());
-        for (sPtr<LibGate> gate : gateList) {
+    for (const sPtr<IntNode>& intNode : intNodeList) {
+        const auto& gateList = _getCandidateGates(intNode);
+        for (LibGate* gate : ptrSpan(gateList)) {
             std::string x_i_k = "x[\"" + intNode->getName() + "\"][\"" + gate->getName() + "\"]";
             std::string area_k = to_string(gate->getBoundary().area());
             outFile << "        areaSum += " << x_i_k << " * " << area_k << ";" << endl;
@@ -202,11 +381,11 @@ bool Legalizer::_genGurobi() {
     
     outFile << "        // (o) (1-alpha)*Cost_hdiff" << endl;
     outFile << "        GRBLinExpr heightMismatchSum = 0;" << endl;
-    for (sPtr<IntNode> intNode : intNodeList) {
+    for (const sPtr<IntNode>& intNode : intNodeList) {
         bool origin_isShortRow = _chip->isRowShort(intNode->getRow()); // True-8T ; False-12T
         bool origin_isTallRow = !origin_isShortRow;
-        const auto& gateList = _gateLibrary->getLibGateList(intNode->getLogic());
-        for (sPtr<LibGate> gate : gateList) {
+        const auto& gateList = _getCandidateGates(intNode);
+        for (LibGate* gate : ptrSpan(gateList)) {
             if ((origin_isShortRow && gate->isTall()) || (origin_isTallRow && gate->isShort())) {
                 std::string x_i_k = "x[\"" + intNode->getName() + "\"][\"" + gate->getName() + "\"]";
                 outFile << "        heightMismatchSum += " << x_i_k << ";" << endl;
@@ -216,6 +395,12 @@ bool Legalizer::_genGurobi() {
     outFile << "        Cost_hdiff = " << "heightMismatchSum" << " / " << intNodeList.size() << ";" << endl;
 
     outFile << "        model.setObjective(alpha*Cost_area+(1-alpha)*Cost_hdiff, GRB_MINIMIZE);" << endl << endl;
+
+    outFile << "        if (argc > 2 && string(argv[1]) == \"--sweep\") {" << endl;
+    outFile << "            paretoSweep(model, argv[2], areaSum, 1.0 / " << chipheight << " / " << chipWidth << ", "
+            << "heightMismatchSum, 1.0 / " << intNodeList.size() << ", c4List, c5LowerList, " << chipWidth << ");" << endl;
+    outFile << "            return 0;" << endl;
+    outFile << "        }" << endl << endl;
     outFile << "        model.optimize();" << endl << endl;
     
     // TODO: write the optimization result to the output file "NIMCH_gurobi_result.txt"
@@ -4,7 +4,9 @@
 #include <string>
 #include <sstream>
 #include <cmath>
+#include <unordered_map>
 #include "legalizer/legalizer.h"
+#include "physical/rowIndex.h"
 
 using namespace std;
 
@@ -105,12 +107,35 @@ bool Legalizer::gen_gurobi() {
         outFile << "        model.addConstr(" << constraint__i << ", \"" << constraint__i << "\");" << endl;
     } // for each PO node
 
+    // Row membership comes from the chip's row index; its node indices (into
+    // chip->nodeList()) are mapped to intNodes once. A row or component the
+    // netlist does not know would silently drop c5 terms, so both are errors.
+    const RowIndex& rowIndex = chip->rowIndex();
+    if (rowIndex.numRows() != numRows) {
+        cerr << "Error: The DEF has " << rowIndex.numRows() << " rows but the netlist has " << numRows << "!" << endl;
+        return false;
+    }
+    unordered_map<std::string, IntNode*> intNodeByName;
+    for (IntNode* intNode : intNodeList) {
+        intNodeByName[intNode->getName()] = intNode;
+    }
+    vector<IntNode*> intNodeOf(chip->nodeList().size(), nullptr);
+    for (size_t v = 0; v < chip->nodeList().size(); ++v) {
+        auto it = intNodeByName.find(chip->nodeList()[v]->name());
+        if (it == intNodeByName.end()) {
+            cerr << "Error: Component " << chip->nodeList()[v]->name() << " is not an intNode!" << endl;
+            return false;
+        }
+        intNodeOf[v] = it->second;
+    }
+
     const double gamma = 0.9;
     for (int r = 0; r < numRows; ++r) {
         outFile << "        GRBLinExpr rowWidth = 0;" << endl;
         for (int nearestRow = r - 1; nearestRow <= r + 1; ++nearestRow) {
             if (nearestRow >= 0 && nearestRow < numRows) {
-                for (IntNode* intNode : _chip.getNodesOnRow(nearestRow)) {
+                for (auto [it, end] = rowIndex.nodesOnRow(nearestRow); it != end; ++it) {
+                    IntNode* intNode = intNodeOf[*it];
                     LibGate::height height = _chip.isRowShort(nearestRow) ? LibGate::height::SHORT : LibGate::height::TALL;
                     for (LibGate* libGate : _gateLibrary.getLibGateList(intNode->getLogic())) {
                         if (libGate->getHeight() == height) {
@@ -0,0 +1,294 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "legalizer/legalizer.h"
+#include "util/ptrSpan.h"
+#include "util/profiler.h"
+
+using namespace std;
+
+/*
+Local-search refinement of the gate choices (refineGateChoices)
+    Starts from resultName (NIMCH_gurobi_result.txt format) if it exists,
+    otherwise from the gates in the input DEF, and writes the refined
+    assignment back to resultName. Moves:
+        - swap:  one node takes another candidate gate of its logic
+        - flip:  two neighboring nodes on a row flip height in opposite
+                 directions, each to its best gate of the new height
+        - trade: two neighboring nodes exchange (height, width), so the c5
+                 sums of every row are unchanged
+    A move is accepted when it lowers
+        alpha * Cost_area + (1 - alpha) * Cost_hdiff
+    (the objective of the two-objective model) and keeps
+        - timing: each node may add at most its share of slack,
+              share(i) = max(0, slack(i)) / depth(i)
+          where depth(i) is the number of nodes on the longest path through
+          i; the shares along any path sum to at most the path slack, so
+          moves in different places never combine into a violation
+        - c5: every affected window stays in [gamma*W, W] (or, if it was
+          already outside, does not move further away)
+    Rows are cut into bands of bandRows (>= 2) rows. A band's moves only
+    touch the c5 sums of its rows and the one row on either side, so bands
+    of the same parity are processed concurrently, even bands first, then
+    odd bands. Each round starts with a full STA that renews the shares;
+    rounds repeat until none of them finds a move or timeBudget seconds
+    have passed.
+*/
+
+bool Legalizer::refineGateChoices(std::string resultName, double timeBudget, int bandRows) {
+    PROFILE_SCOPE("refineGateChoices");
+    _writeLog("Refining gate choices by local search ...\n");
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double>(timeBudget);
+    if (!_buildFaninTable()) return false;
+
+    const auto& intNodeList = _chip->netlist->getIntNodeList();
+    int numNodes = intNodeList.size();
+    int numRows = _chip->getNumRows();
+    double maxDelay = (_maxDelay > 0) ? _maxDelay : _chip->netlist->getMaxDelay();
+    double chipWidth = _chip->getBoundary().width();
+    double areaScale = _alpha / _chip->getBoundary().height() / chipWidth;
+    double hdiffScale = (1 - _alpha) / max(1, numNodes);
+    bandRows = max(2, bandRows);
+
+    // Candidates in flat arrays; the current gate is kept even if dominated
+    vector<int> candOffset(numNodes + 1, 0);
+    vector<const LibGate*> candGate;
+    vector<double> candDelay, candWidth, candArea;
+    vector<char> candTall;
+    vector<int> choice(numNodes, 0);
+    vector<char> rowTall(numRows);
+    for (int r=0; r<numRows; ++r) {
+        rowTall[r] = !_chip->isRowShort(r);
+    }
+    vector<int> nodeRow(numNodes);
+    for (int i=0; i<numNodes; ++i) {
+        const sPtr<IntNode>& intNode = intNodeList[i];
+        const double* delay = _delayArena.data() + _delayOffset[i];
+        const LibGate* current = intNode->getLibGate().get();
+        auto addCand = [&](const LibGate* libGate, int k) {
+            candGate.push_back(libGate);
+            candDelay.push_back(delay[k]);
+            candWidth.push_back(libGate->getBoundary().width());
+            candArea.push_back(libGate->getBoundary().area());
+            candTall.push_back(libGate->isTall());
+        };
+        choice[i] = -1;
+        PtrSpan<LibGate> candGates = _getCandidateGates(intNode);
+        const vector<int>& candIdx = _getCandidateGateIdx(intNode);
+        for (size_t c=0; c<candGates.size(); ++c) {
+            if (candGates[c] == current) choice[i] = candGate.size() - candOffset[i];
+            addCand(candGates[c], candIdx[c]);
+        }
+        if (choice[i] == -1) {
+            int k = _libGateIndex(intNode, current);
+            choice[i] = candGate.size() - candOffset[i];
+            if (k != -1) addCand(current, k);
+            else choice[i] = 0;
+        }
+        candOffset[i + 1] = candGate.size();
+        nodeRow[i] = intNode->getRow();
+    }
+
+    ifstream inFile(resultName);
+    if (inFile.is_open()) {
+        std::string nodeName, gateName;
+        while (inFile >> nodeName >> gateName) {
+            auto it = _intNodeIdx.find(nodeName);
+            if (it == _intNodeIdx.end()) continue;
+            int i = it->second;
+            for (int c=candOffset[i]; c<candOffset[i + 1]; ++c) {
+                if (candGate[c]->getName() == gateName) choice[i] = c - candOffset[i];
+            }
+        }
+        inFile.close();
+    }
+
+    // Fanouts, topological order and depths (see _buildFanoutTable)
+    if (!_buildFanoutTable()) return false;
+    const vector<int>& fanoutOffset = _fanoutOffset;
+    const vector<int>& fanoutNode = _fanoutNode;
+    const vector<int>& fanoutWire = _fanoutWire;
+    const vector<int>& topoOrder = _topoOrder;
+    const vector<int>& depth = _nodeDepth;
+    vector<double> poRequired(numNodes, INFINITY);
+    for (size_t f=0; f<_poFaninWire.size(); ++f) {
+        int w = _poFaninWire[f];
+        if (_wireSource[w] != -1) {
+            poRequired[_wireSource[w]] = min(poRequired[_wireSource[w]], maxDelay - _wireDelay[w]);
+        }
+    }
+
+    // Neighbors: nodes of each row in x order
+    vector<vector<int>> nodesOnRow(numRows);
+    for (int i=0; i<numNodes; ++i) nodesOnRow[nodeRow[i]].push_back(i);
+    for (vector<int>& row : nodesOnRow) {
+        sort(row.begin(), row.end(), [&](int a, int b) {
+            return intNodeList[a]->getBoundary().x1() < intNodeList[b]->getBoundary().x1();
+        });
+    }
+
+    // c5 sums
+    vector<double> windowWidth(numRows, 0.0);
+    for (int i=0; i<numNodes; ++i) {
+        int c = candOffset[i] + choice[i];
+        for (int r=max(0, nodeRow[i] - 1); r<=min(numRows - 1, nodeRow[i] + 1); ++r) {
+            if (rowTall[r] == candTall[c]) windowWidth[r] += candWidth[c];
+        }
+    }
+
+    vector<double> oAT(numNodes), reqOAT(numNodes), share(numNodes);
+    auto sta = [&]() {
+        for (int i : topoOrder) {
+            double iAT = 0.0;
+            for (int f=_faninOffset[i]; f<_faninOffset[i + 1]; ++f) {
+                int w = _faninWire[f];
+                iAT = max(iAT, (_wireSource[w] == -1 ? _wireArrival[w] : oAT[_wireSource[w]]) + _wireDelay[w]);
+            }
+            oAT[i] = iAT + candDelay[candOffset[i] + choice[i]];
+        }
+        for (auto it=topoOrder.rbegin(); it!=topoOrder.rend(); ++it) {
+            int i = *it;
+            double req = poRequired[i];
+            for (int o=fanoutOffset[i]; o<fanoutOffset[i + 1]; ++o) {
+                int j = fanoutNode[o];
+                req = min(req, reqOAT[j] - candDelay[candOffset[j] + choice[j]] - _wireDelay[fanoutWire[o]]);
+            }
+            reqOAT[i] = req;
+            double slack = std::isinf(req) ? maxDelay : req - oAT[i];
+            share[i] = max(0.0, slack) / depth[i];
+        }
+    };
+
+    // A move sets new candidates for one or two nodes of the same band;
+    // returns true (and applies it) if it is legal and improves the cost
+    const double lower = _gamma * chipWidth;
+    auto tryMove = [&](int numMoved, const int* node, const int* cand) -> bool {
+        double deltaCost = 0.0;
+        for (int m=0; m<numMoved; ++m) {
+            int i = node[m];
+            int from = candOffset[i] + choice[i], to = candOffset[i] + cand[m];
+            if (candDelay[to] - candDelay[from] > share[i] + 1e-12) return false;
+            deltaCost += areaScale * (candArea[to] - candArea[from]);
+            deltaCost += hdiffScale * ((candTall[to] != rowTall[nodeRow[i]]) - (candTall[from] != rowTall[nodeRow[i]]));
+        }
+        if (deltaCost > -1e-12) return false;
+        int lo = numRows, hi = -1;
+        for (int m=0; m<numMoved; ++m) {
+            lo = min(lo, max(0, nodeRow[node[m]] - 1));
+            hi = max(hi, min(numRows - 1, nodeRow[node[m]] + 1));
+        }
+        double delta[6] = {0, 0, 0, 0, 0, 0};
+        for (int m=0; m<numMoved; ++m) {
+            int i = node[m];
+            int from = candOffset[i] + choice[i], to = candOffset[i] + cand[m];
+            for (int r=max(0, nodeRow[i] - 1); r<=min(numRows - 1, nodeRow[i] + 1); ++r) {
+                delta[r - lo] += (rowTall[r] == candTall[to] ? candWidth[to] : 0.0)
+                               - (rowTall[r] == candTall[from] ? candWidth[from] : 0.0);
+            }
+        }
+        for (int r=lo; r<=hi; ++r) {
+            double before = windowWidth[r], after = before + delta[r - lo];
+            double excessBefore = max(0.0, lower - before) + max(0.0, before - chipWidth);
+            double excessAfter = max(0.0, lower - after) + max(0.0, after - chipWidth);
+            if (excessAfter > 1e-9 && excessAfter > excessBefore) return false;
+        }
+        for (int r=lo; r<=hi; ++r) windowWidth[r] += delta[r - lo];
+        for (int m=0; m<numMoved; ++m) {
+            int i = node[m];
+            share[i] -= candDelay[candOffset[i] + cand[m]] - candDelay[candOffset[i] + choice[i]];
+            choice[i] = cand[m];
+        }
+        return true;
+    };
+
+    // Smallest-area candidate of node i with the given height (and width if
+    // width >= 0) within its share; -1 if none
+    auto bestOfShape = [&](int i, bool tall, double width) {
+        int best = -1;
+        double limit = candDelay[candOffset[i] + choice[i]] + share[i];
+        for (int c=candOffset[i]; c<candOffset[i + 1]; ++c) {
+            if (candTall[c] != tall || candDelay[c] > limit + 1e-12) continue;
+            if (width >= 0 && candWidth[c] != width) continue;
+            if (best == -1 || candArea[c] < candArea[candOffset[i] + best]) best = c - candOffset[i];
+        }
+        return best;
+    };
+
+    // Returns the number of accepted moves in rows [lo, hi)
+    auto refineBand = [&](int lo, int hi) {
+        size_t numAccepted = 0;
+        for (int r=lo; r<hi; ++r) {
+            const vector<int>& row = nodesOnRow[r];
+            for (size_t p=0; p<row.size(); ++p) {
+                if ((p & 255) == 0 && chrono::steady_clock::now() > deadline) return numAccepted;
+                int i = row[p];
+                for (int k=0; k<candOffset[i + 1] - candOffset[i]; ++k) {       // swap
+                    if (k != choice[i] && tryMove(1, &i, &k)) ++numAccepted;
+                }
+                if (p + 1 == row.size()) continue;
+                int pair[2] = {i, row[p + 1]};
+                bool tallI = candTall[candOffset[i] + choice[i]];
+                bool tallJ = candTall[candOffset[pair[1]] + choice[pair[1]]];
+                if (tallI != tallJ) {                                           // flip
+                    int cand[2] = {bestOfShape(i, tallJ, -1), bestOfShape(pair[1], tallI, -1)};
+                    if (cand[0] != -1 && cand[1] != -1 && tryMove(2, pair, cand)) ++numAccepted;
+                }
+                int ci = candOffset[i] + choice[i], cj = candOffset[pair[1]] + choice[pair[1]];
+                if (candTall[ci] != candTall[cj] || candWidth[ci] != candWidth[cj]) {     // trade
+                    int cand[2] = {bestOfShape(i, candTall[cj], candWidth[cj]),
+                                   bestOfShape(pair[1], candTall[ci], candWidth[ci])};
+                    if (cand[0] != -1 && cand[1] != -1 && tryMove(2, pair, cand)) ++numAccepted;
+                }
+            } // for each node of the row in x order
+        } // for each row of the band
+        return numAccepted;
+    };
+
+    unsigned numThreads = max(1u, thread::hardware_concurrency());
+    int numBands = (numRows + bandRows - 1) / bandRows;
+    size_t totalAccepted = 0;
+    int numRounds = 0;
+    for (int round=0; chrono::steady_clock::now() < deadline; ++round) {
+        ++numRounds;
+        sta();
+        atomic<size_t> numAccepted(0);
+        for (int parity=0; parity<2; ++parity) {
+            atomic<int> next(parity);
+            auto worker = [&]() {
+                for (int b; (b = next.fetch_add(2)) < numBands; ) {
+                    numAccepted += refineBand(b * bandRows, min(numRows, (b + 1) * bandRows));
+                }
+            };
+            vector<thread> threadList;
+            for (unsigned t=1; t<numThreads; ++t) {
+                threadList.emplace_back(worker);
+            }
+            worker();
+            for (auto& th : threadList) {
+                th.join();
+            }
+        }
+        totalAccepted += numAccepted;
+        _writeLog("Round " + to_string(round) + ": " + to_string(numAccepted.load()) + " moves\n");
+        if (numAccepted == 0) break;
+    }
+    PROFILE_COUNT("localSearch/moves", totalAccepted);
+
+    ofstream outFile(resultName);
+    if (!outFile.is_open()) {
+        _writeErrorLog("Error: Failed to open " + resultName + "\n");
+        return false;
+    }
+    for (int i=0; i<numNodes; ++i) {
+        outFile << intNodeList[i]->getName() << " " << candGate[candOffset[i] + choice[i]]->getName() << "\n";
+    }
+    outFile.close();
+    _writeSuccessLog("Local search: " + to_string(totalAccepted) + " moves in " + to_string(numRounds) + " rounds\n");
+    return true;
+}
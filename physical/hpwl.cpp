@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <thread>
+#include "physical/hpwl.h"
+
+namespace {
+
+const Dbu dbuMax = std::numeric_limits<Dbu>::max();
+const Dbu dbuMin = std::numeric_limits<Dbu>::min();
+
+} // namespace
+
+void HpwlEvaluator::build(const Chip* chip, int numThreads) {
+    assert (chip->netlistCSR().finalized());    // NETS loaded (Legalizer::buildHpwl)
+    _chip = chip;
+    _csr = &chip->netlistCSR();
+    const auto& libGateList = chip->libGateList();
+    const auto& nodeList = chip->nodeList();
+
+    _libGateIdx.clear();
+    _libWidth.resize(libGateList.size());
+    _libHeight.resize(libGateList.size());
+    _libPinOffset.assign(libGateList.size(), {});
+    for (size_t g = 0; g < libGateList.size(); ++g) {
+        const LibGate* libGate = libGateList[g];
+        _libGateIdx[libGate] = g;
+        _libWidth[g] = libGate->width();
+        _libHeight[g] = libGate->height();
+        for (const Pin* pin : libGate->pinList()) {
+            PinOffset offset = {libGate->width() / 2, libGate->height() / 2};
+            if (!pin->portList().empty()) {
+                const Port* port = pin->portList()[0];
+                offset = {(port->x1() + port->x2()) / 2, (port->y1() + port->y2()) / 2};
+            }
+            _libPinOffset[g].push_back(offset);
+        }
+    }
+
+    size_t numNodes = nodeList.size();
+    _nodeX.resize(numNodes);
+    _nodeY.resize(numNodes);
+    _nodeOrient.resize(numNodes);
+    _nodeLib.resize(numNodes);
+    for (size_t v = 0; v < numNodes; ++v) {
+        _nodeX[v] = nodeList[v]->boundary().x1();
+        _nodeY[v] = nodeList[v]->boundary().y1();
+        _nodeOrient[v] = nodeList[v]->orient();
+        _nodeLib[v] = _libGateIdx.at(nodeList[v]->libGate());
+    }
+
+    // node -> CSR pins
+    int numPins = _csr->numPins();
+    _nodePinOffset.assign(numNodes + 1, 0);
+    for (int p = 0; p < numPins; ++p) {
+        ++_nodePinOffset[_csr->pinNode[p] + 1];
+    }
+    for (size_t v = 0; v < numNodes; ++v) {
+        _nodePinOffset[v + 1] += _nodePinOffset[v];
+    }
+    _nodePins.resize(numPins);
+    std::vector<int> fill(_nodePinOffset.begin(), _nodePinOffset.end() - 1);
+    for (int p = 0; p < numPins; ++p) {
+        _nodePins[fill[_csr->pinNode[p]]++] = p;
+    }
+
+    _pinX.resize(numPins);
+    _pinY.resize(numPins);
+    _pinLibPin = _csr->pinLibPin;
+    for (int p = 0; p < numPins; ++p) {
+        pinPosition(_csr->pinNode[p], _pinLibPin[p], _pinX[p], _pinY[p]);
+    }
+    recomputeAll(numThreads);
+}
+
+void HpwlEvaluator::pinPosition(int v, int libPin, Dbu& x, Dbu& y) const {
+    int g = _nodeLib[v];
+    Dbu dx = _libWidth[g] / 2, dy = _libHeight[g] / 2;
+    if (libPin != -1) {
+        dx = _libPinOffset[g][libPin].dx;
+        dy = _libPinOffset[g][libPin].dy;
+    }
+    switch (_nodeOrient[v]) {
+        case Node::FS: dy = _libHeight[g] - dy; break;
+        case Node::S:  dx = _libWidth[g] - dx; dy = _libHeight[g] - dy; break;
+        case Node::FN: dx = _libWidth[g] - dx; break;
+        default: break;
+    }
+    x = _nodeX[v] + dx;
+    y = _nodeY[v] + dy;
+}
+
+void HpwlEvaluator::computeNet(int net) {
+    int begin = _csr->netPinOffset[net], end = _csr->netPinOffset[net + 1];
+    const Dbu* px = _pinX.data();
+    const Dbu* py = _pinY.data();
+    BBox b = {dbuMax, dbuMin, dbuMax, dbuMin, 0, 0, 0, 0};
+    // Branch-free min/max reductions over contiguous pins (vectorizable)
+    for (int p = begin; p < end; ++p) {
+        b.xMin = std::min(b.xMin, px[p]);
+        b.xMax = std::max(b.xMax, px[p]);
+        b.yMin = std::min(b.yMin, py[p]);
+        b.yMax = std::max(b.yMax, py[p]);
+    }
+    for (int p = begin; p < end; ++p) {
+        b.nXMin += (px[p] == b.xMin);
+        b.nXMax += (px[p] == b.xMax);
+        b.nYMin += (py[p] == b.yMin);
+        b.nYMax += (py[p] == b.yMax);
+    }
+    _bbox[net] = b;
+}
+
+void HpwlEvaluator::recomputeAll(int numThreads) {
+    int numNets = _csr->numNets();
+    _bbox.resize(numNets);
+    if (numThreads <= 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (numNets < 65536) numThreads = 1;
+
+    std::vector<Dbu> partial(numThreads, 0);
+    auto work = [&](int t) {
+        int begin = (long long)numNets * t / numThreads;
+        int end = (long long)numNets * (t + 1) / numThreads;
+        Dbu sum = 0;
+        for (int n = begin; n < end; ++n) {
+            computeNet(n);
+            sum += netHpwl(n);
+        }
+        partial[t] = sum;
+    };
+    std::vector<std::thread> threadList;
+    for (int t = 1; t < numThreads; ++t) {
+        threadList.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& thread : threadList) {
+        thread.join();
+    }
+    _total = 0;
+    for (Dbu sum : partial) {
+        _total += sum;
+    }
+}
+
+// Moves one pin across a bbox edge; returns false when the edge must be rescanned
+static inline bool updateEdge(Dbu& edge, int& count, Dbu oldV, Dbu newV, bool isMin) {
+    bool extends = isMin ? (newV < edge) : (newV > edge);
+    if (extends) {
+        edge = newV;
+        count = 1;
+        return true;
+    }
+    if (newV == edge && oldV != edge) {
+        ++count;
+    }
+    else if (oldV == edge && newV != edge) {
+        if (--count == 0) return false;     // edge lost its last pin: rescan
+    }
+    return true;
+}
+
+void HpwlEvaluator::updatePin(int net, Dbu oldX, Dbu oldY, Dbu newX, Dbu newY) {
+    BBox& b = _bbox[net];
+    bool ok = updateEdge(b.xMin, b.nXMin, oldX, newX, true);
+    ok = updateEdge(b.xMax, b.nXMax, oldX, newX, false) && ok;
+    ok = updateEdge(b.yMin, b.nYMin, oldY, newY, true) && ok;
+    ok = updateEdge(b.yMax, b.nYMax, oldY, newY, false) && ok;
+    if (!ok) {
+        computeNet(net);
+    }
+}
+
+Dbu HpwlEvaluator::moveNode(int v, Dbu x1, Dbu y1, Node::orient orient, const LibGate* libGate) {
+    const NetlistCSR& csr = *_csr;
+
+    // Old HPWL of the incident nets
+    Dbu before = 0;
+    for (int i = csr.nodeNetOffset[v]; i < csr.nodeNetOffset[v + 1]; ++i) {
+        before += netHpwl(csr.nodeNet[i]);
+    }
+
+    _nodeX[v] = x1;
+    _nodeY[v] = y1;
+    _nodeOrient[v] = orient;
+    if (libGate && _libGateIdx.at(libGate) != _nodeLib[v]) {
+        // Lib pin indices differ between gates; map each pin by name
+        const LibGate* oldGate = _chip->libGateList()[_nodeLib[v]];
+        const auto& pinName2Idx = libGate->pinName2Idx();
+        for (int i = _nodePinOffset[v]; i < _nodePinOffset[v + 1]; ++i) {
+            int& libPin = _pinLibPin[_nodePins[i]];
+            if (libPin == -1) continue;
+            auto it = pinName2Idx.find(oldGate->pinList()[libPin]->name());
+            libPin = (it != pinName2Idx.end()) ? it->second : -1;
+        }
+        _nodeLib[v] = _libGateIdx.at(libGate);
+    }
+
+    for (int i = _nodePinOffset[v]; i < _nodePinOffset[v + 1]; ++i) {
+        int p = _nodePins[i];
+        Dbu oldX = _pinX[p], oldY = _pinY[p];
+        pinPosition(v, _pinLibPin[p], _pinX[p], _pinY[p]);
+        if (oldX == _pinX[p] && oldY == _pinY[p]) continue;
+        updatePin(csr.pinNet[p], oldX, oldY, _pinX[p], _pinY[p]);
+    }
+
+    Dbu after = 0;
+    for (int i = csr.nodeNetOffset[v]; i < csr.nodeNetOffset[v + 1]; ++i) {
+        after += netHpwl(csr.nodeNet[i]);
+    }
+    _total += after - before;
+    return after - before;
+}
@@ -0,0 +1,74 @@
+#ifndef HPWL_H
+#define HPWL_H
+
+#include <unordered_map>
+#include <vector>
+#include "physical/netlistCSR.h"
+#include "physical/ntkObject.h"
+#include "util/dbu.h"
+
+/*
+Half-perimeter wirelength over the DEF NETS (NetlistCSR)
+    Pin positions are the node's lower-left corner plus the center of the
+    lib pin's first port rectangle, mirrored according to the node
+    orientation. Every net caches its bounding box and how many pins sit on
+    each of its four edges, so moving one node only touches its incident nets:
+    a pin that extends or stays on an edge is O(1), and a net is rescanned
+    (O(degree)) only when the last pin leaves one of its edges.
+The NETS section is parsed lazily, so build through Legalizer::buildHpwl,
+which parses it first; build itself asserts that the netlist is loaded.
+*/
+
+class HpwlEvaluator {
+public:
+    void build(const Chip* chip, int numThreads = 0);
+    // Rescans every net; nets are split across numThreads (0: all cores)
+    void recomputeAll(int numThreads = 0);
+
+    Dbu total() const { return _total; }
+    Dbu netHpwl(int net) const {
+        const BBox& b = _bbox[net];
+        return b.xMax < b.xMin ? 0 : (b.xMax - b.xMin) + (b.yMax - b.yMin);
+    }
+
+    // Moves / resizes node v and updates its incident nets; returns the HPWL delta.
+    // With a new libGate, each pin is mapped to the new gate's pin of the same
+    // name (a pin the new gate lacks sits at the gate center).
+    Dbu moveNode(int v, Dbu x1, Dbu y1, Node::orient orient, const LibGate* libGate = nullptr);
+
+private:
+    struct BBox {
+        Dbu xMin, xMax, yMin, yMax;
+        int nXMin, nXMax, nYMin, nYMax;     // pins on each edge
+    };
+    struct PinOffset {
+        Dbu dx, dy;
+    };
+
+    void computeNet(int net);
+    void updatePin(int net, Dbu oldX, Dbu oldY, Dbu newX, Dbu newY);
+    void pinPosition(int v, int libPin, Dbu& x, Dbu& y) const;
+
+    const Chip* _chip = nullptr;
+    const NetlistCSR* _csr = nullptr;
+
+    // Per lib gate: width, height and the port center of each lib pin
+    std::unordered_map<const LibGate*, int> _libGateIdx;
+    std::vector<Dbu> _libWidth, _libHeight;
+    std::vector<std::vector<PinOffset>> _libPinOffset;
+
+    // Per node placement
+    std::vector<Dbu> _nodeX, _nodeY;
+    std::vector<Node::orient> _nodeOrient;
+    std::vector<int> _nodeLib;
+    // Per CSR pin position and lib pin of the node's current gate (-1: none);
+    // _nodePins lists the CSR pins of each node
+    std::vector<Dbu> _pinX, _pinY;
+    std::vector<int> _pinLibPin;
+    std::vector<int> _nodePinOffset, _nodePins;
+
+    std::vector<BBox> _bbox;
+    Dbu _total = 0;
+};
+
+#endif // HPWL_H
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include "physical/netlistCSR.h"
+
+void NetlistCSR::clear() {
+    netPinOffset.clear();
+    pinNode.clear();
+    pinLibPin.clear();
+    pinIsOutput.clear();
+    pinNet.clear();
+    nodeNetOffset.clear();
+    nodeNet.clear();
+}
+
+void NetlistCSR::reserve(size_t numNets, size_t numPins) {
+    netPinOffset.reserve(numNets + 1);
+    pinNode.reserve(numPins);
+    pinLibPin.reserve(numPins);
+    pinIsOutput.reserve(numPins);
+}
+
+void NetlistCSR::finalize(int numNodes) {
+    netPinOffset.push_back(pinNode.size());
+    int numNets = this->numNets();
+
+    pinNet.resize(pinNode.size());
+    for (int n = 0; n < numNets; ++n) {
+        std::fill(pinNet.begin() + netPinOffset[n], pinNet.begin() + netPinOffset[n + 1], n);
+    }
+
+    // Counting sort of (node, net) pairs; a node on a net through several pins
+    // is listed once
+    nodeNetOffset.assign(numNodes + 1, 0);
+    std::vector<int> lastNet(numNodes, -1);
+    for (int n = 0; n < numNets; ++n) {
+        for (int p = netPinOffset[n]; p < netPinOffset[n + 1]; ++p) {
+            int v = pinNode[p];
+            if (lastNet[v] != n) {
+                lastNet[v] = n;
+                ++nodeNetOffset[v + 1];
+            }
+        }
+    }
+    for (int v = 0; v < numNodes; ++v) {
+        nodeNetOffset[v + 1] += nodeNetOffset[v];
+    }
+    nodeNet.resize(nodeNetOffset[numNodes]);
+    std::vector<int> fill(nodeNetOffset.begin(), nodeNetOffset.end() - 1);
+    lastNet.assign(numNodes, -1);
+    for (int n = 0; n < numNets; ++n) {
+        for (int p = netPinOffset[n]; p < netPinOffset[n + 1]; ++p) {
+            int v = pinNode[p];
+            if (lastNet[v] != n) {
+                lastNet[v] = n;
+                nodeNet[fill[v]++] = n;
+            }
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef NETLIST_CSR_H
+#define NETLIST_CSR_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+Compressed-sparse-row hypergraph of the DEF NETS
+    net n has pins netPinOffset[n] .. netPinOffset[n+1]-1
+    pin p belongs to node pinNode[p] and is lib pin pinLibPin[p] of its gate
+    (the index into LibGate::pinList / Node::pinList); pinIsOutput[p] marks drivers
+    and pinNet[p] is the net of pin p
+    node v is on nets nodeNet[nodeNetOffset[v] .. nodeNetOffset[v+1]-1] (transpose)
+Net and node indices match Chip::wireList and Chip::nodeList. Pins on I/O
+ports (( PIN name )) are not part of any node and are not stored.
+*/
+
+class NetlistCSR {
+public:
+    void clear();
+    void reserve(size_t numNets, size_t numPins);
+
+    // Called while parsing NETS: one beginNet per wire, then its pins
+    void beginNet() { netPinOffset.push_back(pinNode.size()); }
+    void addPin(int node, int libPin, bool isOutput) {
+        pinNode.push_back(node);
+        pinLibPin.push_back(libPin);
+        pinIsOutput.push_back(isOutput);
+    }
+    // Closes the last net and builds pinNet and the node -> net transpose
+    void finalize(int numNodes);
+
+    // False until finalize, e.g. while the NETS section is not parsed yet
+    bool finalized() const { return !netPinOffset.empty(); }
+    int numNets() const { return (int)netPinOffset.size() - 1; }
+    int numPins() const { return pinNode.size(); }
+    int netDegree(int net) const { return netPinOffset[net + 1] - netPinOffset[net]; }
+
+    std::vector<int> netPinOffset;
+    std::vector<int> pinNode;
+    std::vector<int> pinLibPin;
+    std::vector<char> pinIsOutput;
+    std::vector<int> pinNet;
+    std::vector<int> nodeNetOffset;
+    std::vector<int> nodeNet;
+};
+
+#endif // NETLIST_CSR_H
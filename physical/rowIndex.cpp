@@ -0,0 +1,55 @@
+#include <cassert>
+#include <numeric>
+#include "physical/rowIndex.h"
+#include "physical/ntkObject.h"
+
+void RowIndex::build(const std::vector<Row*>& rowList, Dbu siteWidth) {
+    assert (siteWidth > 0);
+    _siteWidth = siteWidth;
+    size_t numRows = rowList.size();
+    _rowY1.resize(numRows);
+    _rowY2.resize(numRows);
+    _rowX1.resize(numRows);
+    _rowNumSites.resize(numRows);
+    _slotToRow.clear();
+    if (numRows == 0) return;
+
+    _y0 = rowList[0]->boundary().y1();
+    _pitch = 0;
+    for (size_t r = 0; r < numRows; ++r) {
+        const auto& box = rowList[r]->boundary();
+        assert (r == 0 || box.y1() >= _rowY2[r - 1]);     // sorted, non-overlapping
+        _rowY1[r] = box.y1();
+        _rowY2[r] = box.y2();
+        _rowX1[r] = box.x1();
+        _rowNumSites[r] = (box.x2() - box.x1()) / siteWidth;
+        _pitch = std::gcd(_pitch, box.y1() - _y0);
+        _pitch = std::gcd(_pitch, box.y2() - _y0);
+    }
+    assert (_pitch > 0);
+
+    _slotToRow.assign((_rowY2.back() - _y0) / _pitch, -1);
+    for (size_t r = 0; r < numRows; ++r) {
+        for (Dbu y = _rowY1[r]; y < _rowY2[r]; y += _pitch) {
+            _slotToRow[(y - _y0) / _pitch] = r;
+        }
+    }
+}
+
+void RowIndex::assignNodes(const std::vector<Node*>& nodeList) {
+    int numRows = this->numRows();
+    _nodeRow.resize(nodeList.size());
+    _rowNodeOffset.assign(numRows + 1, 0);
+    for (size_t i = 0; i < nodeList.size(); ++i) {
+        _nodeRow[i] = rowAt(nodeList[i]->boundary().y1());
+        if (_nodeRow[i] != -1) ++_rowNodeOffset[_nodeRow[i] + 1];
+    }
+    for (int r = 0; r < numRows; ++r) {
+        _rowNodeOffset[r + 1] += _rowNodeOffset[r];
+    }
+    _rowNodes.resize(_rowNodeOffset[numRows]);
+    std::vector<int> fill(_rowNodeOffset.begin(), _rowNodeOffset.end() - 1);
+    for (size_t i = 0; i < nodeList.size(); ++i) {
+        if (_nodeRow[i] != -1) _rowNodes[fill[_nodeRow[i]]++] = i;
+    }
+}
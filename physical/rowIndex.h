@@ -0,0 +1,61 @@
+#ifndef ROW_INDEX_H
+#define ROW_INDEX_H
+
+#include <utility>
+#include <vector>
+#include "util/dbu.h"
+
+class Row;
+class Node;
+
+/*
+Constant-time y -> row lookup and row membership
+    Row bottoms are quantized on a grid whose pitch is the gcd of all row
+    heights (e.g. 8T/12T rows share a 4T grid), and every grid slot stores the
+    row covering it, so rowAt(y) is one subtraction, one division and one load.
+    Rows also keep their site range, and assignNodes builds a row -> node CSR
+    table so the nodes of a row are a contiguous index range.
+*/
+
+class RowIndex {
+public:
+    void build(const std::vector<Row*>& rowList, Dbu siteWidth);
+    void assignNodes(const std::vector<Node*>& nodeList);
+
+    int numRows() const { return _rowY1.size(); }
+    // Index of the row whose [y1, y2) contains y, or -1
+    int rowAt(Dbu y) const {
+        if (y < _y0) return -1;
+        size_t slot = (y - _y0) / _pitch;
+        return slot < _slotToRow.size() ? _slotToRow[slot] : -1;
+    }
+    Dbu rowY1(int r) const { return _rowY1[r]; }
+    Dbu rowY2(int r) const { return _rowY2[r]; }
+
+    // Sites of row r are siteX(r, 0), ..., siteX(r, numSites(r) - 1)
+    int numSites(int r) const { return _rowNumSites[r]; }
+    Dbu siteX(int r, int site) const { return _rowX1[r] + site * _siteWidth; }
+    // Site index containing x on row r (may be out of [0, numSites(r)))
+    int siteAt(int r, Dbu x) const {
+        return (snapDownToSite(x, _rowX1[r], _siteWidth) - _rowX1[r]) / _siteWidth;
+    }
+
+    // Node indices (into the list given to assignNodes) whose bottom lies on row r
+    std::pair<const int*, const int*> nodesOnRow(int r) const {
+        return {_rowNodes.data() + _rowNodeOffset[r], _rowNodes.data() + _rowNodeOffset[r + 1]};
+    }
+    const std::vector<int>& nodeRow() const { return _nodeRow; }
+
+private:
+    Dbu _y0 = 0;
+    Dbu _pitch = 1;
+    Dbu _siteWidth = 1;
+    std::vector<int> _slotToRow;
+    std::vector<Dbu> _rowY1, _rowY2, _rowX1;
+    std::vector<int> _rowNumSites;
+    std::vector<int> _rowNodeOffset;    // size numRows() + 1
+    std::vector<int> _rowNodes;
+    std::vector<int> _nodeRow;
+};
+
+#endif // ROW_INDEX_H
@@ -0,0 +1,272 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "legalizer/legalizer.h"
+#include "util/strOperation.h"
+#include "physical/ntkObject.h"
+#include "util/dbu.h"
+#include "util/logger.h"
+#include "physical/rowIndex.h"
+#include "util/compressedInput.h"
+
+/*
+Resident server
+    -s/--server <socketPath> <libraryPath>
+        parses <libraryPath>_8T.macro.lef and <libraryPath>_12T.macro.lef once
+        and serves requests on a Unix-domain stream socket until "shutdown".
+        Each design loaded with load-def replaces the previous one but reuses
+        the parsed library, so repeated experiments skip all startup cost.
+Protocol: one command per line; every command gets one reply line starting
+with "ok" or "error". Connections are served one at a time.
+    load-def <def>                      parse a design against the loaded library
+    set-params [gamma=<g>] [alpha=<a>] [maxDelay=<d>]
+                                        maxDelay <= 0 restores the netlist value
+    select-gates                        write the Gurobi model and run the solver
+                                        ($NIMCH_SOLVER, default ./NIMCH_gurobi),
+                                        leaving NIMCH_gurobi_result.txt; the
+                                        program is design-independent, so one
+                                        build serves every design
+    legalize                            apply NIMCH_gurobi_result.txt to the design
+    check                               row capacity, site alignment and die bounds
+    write-def <def>                     the input DEF with the current macros;
+                                        <def> may be the input DEF itself, its
+                                        NETS are loaded first
+    shutdown
+*/
+
+namespace {
+
+bool readLine(int fd, std::string& buffer, std::string& line) {
+    while (true) {
+        size_t pos = buffer.find('\n');
+        if (pos != std::string::npos) {
+            line = buffer.substr(0, pos);
+            buffer.erase(0, pos + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        char chunk[4096];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) return false;
+        buffer.append(chunk, n);
+    }
+}
+
+void writeReply(int fd, const std::string& reply) {
+    std::string out = reply + "\n";
+    const char* p = out.data();
+    size_t left = out.size();
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n <= 0) return;
+        p += n;
+        left -= n;
+    }
+}
+
+bool sameFile(const std::string& a, const std::string& b) {
+    struct stat stA, stB;
+    if (stat(a.c_str(), &stA) != 0 || stat(b.c_str(), &stB) != 0) return false;
+    return stA.st_dev == stB.st_dev && stA.st_ino == stB.st_ino;
+}
+
+// Copies inputDef to outputDef, replacing the macro of every component with
+// the libGate its node currently has. The copy goes to a temporary file that
+// is renamed over outputDef, so outputDef may be inputDef itself.
+bool writeDefWithGates(Chip* chip, const std::string& inputDef, const std::string& outputDef) {
+    // The copy is line based and does not decompress
+    if (CompressedInput(inputDef).format() != CompressedInput::PLAIN) {
+        LOG_ERROR("write-def needs an uncompressed input DEF, " << inputDef << " is compressed\n");
+        return false;
+    }
+    std::string tmpName = outputDef + ".tmp";
+    std::ifstream inFile(inputDef);
+    std::ofstream outFile(tmpName);
+    if (!inFile.is_open() || !outFile.is_open()) {
+        LOG_ERROR("Failed to open " << (inFile.is_open() ? tmpName : inputDef) << "\n");
+        return false;
+    }
+
+    const auto& nodeMap = chip->nodeName2Idx();
+    bool inComponents = false;
+    std::string line;
+    while (std::getline(inFile, line)) {
+        std::istringstream tokens(line);
+        std::string first, compName, macroName;
+        tokens >> first;
+        if (first == "COMPONENTS") inComponents = true;
+        else if (first == "END") inComponents = false;
+        else if (inComponents && first == "-" && tokens >> compName >> macroName) {
+            auto nodeIt = nodeMap.find(compName);
+            if (nodeIt != nodeMap.end()) {
+                size_t pos = line.find(macroName, line.find(compName) + compName.size());
+                line.replace(pos, macroName.size(), chip->nodeList()[nodeIt->second]->libGate()->name());
+            }
+        }
+        outFile << line << "\n";
+    }
+    outFile.close();
+    if (!outFile || std::rename(tmpName.c_str(), outputDef.c_str()) != 0) {
+        LOG_ERROR("Failed to write " << outputDef << "\n");
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool Legalizer::runServer(int argc, char **argv) {
+    assert ((argc == 4) &&
+            (std::string(argv[1]) == "-s" || std::string(argv[1]) == "--server"));
+
+    std::string socketPath = argv[2];
+    std::string inputLibraryPath = argv[3];
+
+    if (!parseInputMacroLef(inputLibraryPath + "_8T.macro.lef") ||
+        !parseInputMacroLef(inputLibraryPath + "_12T.macro.lef")) {
+        LOG_ERROR("Failed to parse the library " << inputLibraryPath << "\n");
+        return false;
+    }
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (listenFd < 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Failed to create socket " << socketPath << "\n");
+        return false;
+    }
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 8) != 0) {
+        LOG_ERROR("Failed to listen on " << socketPath << "\n");
+        close(listenFd);
+        return false;
+    }
+    LOG_INFO("Serving " << inputLibraryPath << " on " << socketPath << "\n");
+
+    const char* solverEnv = std::getenv("NIMCH_SOLVER");
+    std::string solver = solverEnv ? solverEnv : "./NIMCH_gurobi";
+    std::string inputDef;
+    bool running = true;
+
+    while (running) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::string buffer, line;
+        while (running && readLine(fd, buffer, line)) {
+            std::istringstream tokens(line);
+            std::string command;
+            tokens >> command;
+            if (command.empty()) continue;
+            LOG_DEBUG("server: " << line << "\n");
+
+            if (command == "load-def") {
+                std::string defName;
+                tokens >> defName;
+                chip->clearDesign();
+                _clearDelayTables();
+                if (defName.empty() || !parseInputDef(defName)) {
+                    inputDef.clear();
+                    writeReply(fd, "error failed to parse " + defName);
+                    continue;
+                }
+                inputDef = defName;
+                writeReply(fd, "ok " + std::to_string(chip->nodeList().size()) + " components, "
+                               + std::to_string(chip->rowList().size()) + " rows");
+            }
+            else if (command == "set-params") {
+                std::string param;
+                bool ok = true;
+                while (tokens >> param) {
+                    size_t eq = param.find('=');
+                    std::string key = param.substr(0, eq);
+                    char* end = nullptr;
+                    double value = (eq == std::string::npos) ? 0.0 : std::strtod(param.c_str() + eq + 1, &end);
+                    if (eq == std::string::npos || end == param.c_str() + eq + 1 || *end != '\0') ok = false;
+                    else if (key == "gamma") _gamma = value;
+                    else if (key == "alpha") _alpha = value;
+                    else if (key == "maxDelay") _maxDelay = value;
+                    else ok = false;
+                }
+                std::ostringstream reply;
+                reply << (ok ? "ok" : "error invalid parameter,") << " gamma=" << _gamma
+                      << " alpha=" << _alpha << " maxDelay=" << _maxDelay;
+                writeReply(fd, reply.str());
+            }
+            else if (inputDef.empty() && command != "shutdown") {
+                writeReply(fd, "error no design loaded");
+            }
+            else if (command == "select-gates") {
+                if (!_genGurobi()) {
+                    writeReply(fd, "error failed to generate the model");
+                    continue;
+                }
+                int status = std::system(solver.c_str());
+                writeReply(fd, status == 0 ? "ok NIMCH_gurobi_result.txt"
+                                           : "error " + solver + " exited with " + std::to_string(status));
+            }
+            else if (command == "legalize") {
+                writeReply(fd, parseGurobiResult("NIMCH_gurobi_result.txt") ? "ok"
+                                                                            : "error failed to apply NIMCH_gurobi_result.txt");
+            }
+            else if (command == "check") {
+                size_t overfullRows = 0, offSite = 0, outside = 0;
+                const auto& rowList = chip->rowList();
+                const auto& nodeList = chip->nodeList();
+                const auto& die = chip->boundary();
+                // Row widths are summed from the row index, not from the cached usedWidth
+                const RowIndex& rowIndex = chip->rowIndex();
+                for (int r = 0; r < rowIndex.numRows(); ++r) {
+                    Dbu usedWidth = 0;
+                    for (auto [it, end] = rowIndex.nodesOnRow(r); it != end; ++it) {
+                        usedWidth += nodeList[*it]->libGate()->width();
+                    }
+                    if (usedWidth > rowList[r]->boundary().x2() - rowList[r]->boundary().x1()) ++overfullRows;
+                }
+                for (size_t i = 0; i < nodeList.size(); ++i) {
+                    const auto& box = nodeList[i]->boundary();
+                    int r = chip->rowIndex().nodeRow()[i];
+                    if (r == -1 || !isOnSite(box.x1(), rowList[r]->boundary().x1(), chip->siteWidth())) ++offSite;
+                    if (box.x1() < die.x1() || box.x2() > die.x2() || box.y1() < die.y1() || box.y2() > die.y2()) ++outside;
+                }
+                std::string result = std::to_string(overfullRows) + " overfull rows, " + std::to_string(offSite)
+                                     + " off-site cells, " + std::to_string(outside) + " cells outside the die";
+                writeReply(fd, std::string(overfullRows + offSite + outside == 0 ? "ok " : "error ") + result);
+            }
+            else if (command == "write-def") {
+                std::string defName;
+                tokens >> defName;
+                // Rewritten macro names shift the byte offsets that loadDefNets
+                // reads NETS from, so NETS must be in memory before the input changes
+                if (!defName.empty() && sameFile(defName, inputDef) && !loadDefNets()) {
+                    writeReply(fd, "error failed to load the NETS of " + inputDef + " before overwriting it");
+                    continue;
+                }
+                writeReply(fd, !defName.empty() && writeDefWithGates(chip, inputDef, defName)
+                               ? "ok " + defName : "error failed to write " + defName);
+            }
+            else if (command == "shutdown") {
+                writeReply(fd, "ok");
+                running = false;
+            }
+            else {
+                writeReply(fd, "error unknown command " + command);
+            }
+        }
+        close(fd);
+    }
+
+    close(listenFd);
+    unlink(socketPath.c_str());
+    return true;
+}
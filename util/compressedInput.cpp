@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "util/compressedInput.h"
+
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define NIMCH_HAVE_ZLIB 1
+#endif
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define NIMCH_HAVE_ZSTD 1
+#endif
+
+CompressedInput::CompressedInput(const std::string& fileName, size_t startOffset) : _fileName(fileName) {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        _error = "cannot open " + fileName;
+        return;
+    }
+    unsigned char magic[4] = {0, 0, 0, 0};
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        _format = GZIP;
+    }
+    else if (n == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        _format = ZSTD;
+    }
+
+#ifndef NIMCH_HAVE_ZLIB
+    if (_format == GZIP) {
+        _error = fileName + " is gzip-compressed but zlib support is not compiled in";
+        ::close(fd);
+        return;
+    }
+#endif
+#ifndef NIMCH_HAVE_ZSTD
+    if (_format == ZSTD) {
+        _error = fileName + " is zstd-compressed but libzstd support is not compiled in";
+        ::close(fd);
+        return;
+    }
+#endif
+
+    if (_format == PLAIN && startOffset > 0) {
+        if (lseek(fd, startOffset, SEEK_SET) < 0) {
+            _error = "cannot seek in " + fileName;
+            ::close(fd);
+            return;
+        }
+        _chunkOffset = startOffset;
+    }
+    else {
+        _skip = startOffset;
+    }
+
+    _exist = true;
+    _producer = std::thread([this, fd]() {
+        switch (_format) {
+            case GZIP: produceGzip(fd); break;
+            case ZSTD: produceZstd(fd); break;
+            default:   produceFile(fd); break;
+        }
+        ::close(fd);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done = true;
+        _notEmpty.notify_all();
+    });
+}
+
+CompressedInput::~CompressedInput() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+    }
+    _notFull.notify_all();
+    if (_producer.joinable()) {
+        _producer.join();
+    }
+}
+
+bool CompressedInput::push(std::string&& chunk) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notFull.wait(lock, [this]() { return _queue.size() < kMaxChunks || _closed; });
+    if (_closed) return false;
+    _queue.push_back(std::move(chunk));
+    _notEmpty.notify_one();
+    return true;
+}
+
+void CompressedInput::fail(const std::string& message) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_error.empty()) _error = _fileName + ": " + message;
+}
+
+bool CompressedInput::nextChunk() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notEmpty.wait(lock, [this]() { return !_queue.empty() || _done; });
+    if (_queue.empty()) return false;
+    _chunkOffset += _chunk.size();
+    _chunk = std::move(_queue.front());
+    _queue.pop_front();
+    _pos = std::min(_skip, _chunk.size());
+    _skip -= _pos;
+    _notFull.notify_one();
+    return true;
+}
+
+void CompressedInput::produceFile(int fd) {
+    while (true) {
+        std::string chunk(kChunkSize, '\0');
+        ssize_t n = ::read(fd, &chunk[0], kChunkSize);
+        if (n < 0) {
+            fail("read error");
+            return;
+        }
+        if (n == 0) return;
+        chunk.resize(n);
+        if (!push(std::move(chunk))) return;
+    }
+}
+
+void CompressedInput::produceGzip(int fd) {
+#ifdef NIMCH_HAVE_ZLIB
+    z_stream zs = {};
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) {   // +32: gzip/zlib header detection
+        fail("inflateInit failed");
+        return;
+    }
+    std::vector<unsigned char> inBuf(256 << 10);
+    std::string chunk(kChunkSize, '\0');
+    zs.next_out = (Bytef*)&chunk[0];
+    zs.avail_out = kChunkSize;
+    bool eof = false;
+    bool memberEnded = false;
+
+    while (true) {
+        if (zs.avail_in == 0 && !eof) {
+            ssize_t n = ::read(fd, inBuf.data(), inBuf.size());
+            if (n < 0) {
+                fail("read error");
+                break;
+            }
+            eof = (n == 0);
+            zs.next_in = inBuf.data();
+            zs.avail_in = n;
+        }
+        if (zs.avail_in == 0 && eof) break;
+
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        memberEnded = (ret == Z_STREAM_END);
+        if (ret == Z_STREAM_END) {
+            // Concatenated members (gzip a b > c, pigz) continue after a reset
+            inflateReset(&zs);
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            fail(std::string("corrupt gzip data: ") + (zs.msg ? zs.msg : "inflate failed"));
+            break;
+        }
+        if (zs.avail_out == 0) {
+            if (!push(std::move(chunk))) break;
+            chunk.assign(kChunkSize, '\0');
+            zs.next_out = (Bytef*)&chunk[0];
+            zs.avail_out = kChunkSize;
+        }
+    }
+    chunk.resize(kChunkSize - zs.avail_out);
+    if (!chunk.empty()) push(std::move(chunk));
+    if (eof && !memberEnded) fail("truncated gzip data");
+    inflateEnd(&zs);
+#else
+    (void)fd;
+#endif
+}
+
+void CompressedInput::produceZstd(int fd) {
+#ifdef NIMCH_HAVE_ZSTD
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fail("cannot stat");
+        return;
+    }
+    size_t fileSize = st.st_size;
+    const char* data = (const char*)mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        fail("cannot map");
+        return;
+    }
+    madvise((void*)data, fileSize, MADV_SEQUENTIAL);
+
+    // Frame boundaries
+    std::vector<std::pair<size_t, size_t>> frameList;     // (offset, compressed size)
+    for (size_t offset = 0; offset < fileSize; ) {
+        size_t size = ZSTD_findFrameCompressedSize(data + offset, fileSize - offset);
+        if (ZSTD_isError(size)) {
+            fail(std::string("corrupt zstd data: ") + ZSTD_getErrorName(size));
+            munmap((void*)data, fileSize);
+            return;
+        }
+        frameList.push_back({offset, size});
+        offset += size;
+    }
+
+    // Streams one frame; emit() receives the output in chunks of kChunkSize
+    auto decompressFrame = [&](size_t f, ZSTD_DCtx* dctx, auto&& emit) -> bool {
+        ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+        ZSTD_inBuffer in = {data + frameList[f].first, frameList[f].second, 0};
+        std::string chunk(kChunkSize, '\0');
+        ZSTD_outBuffer out = {&chunk[0], kChunkSize, 0};
+        while (true) {
+            size_t ret = ZSTD_decompressStream(dctx, &out, &in);
+            if (ZSTD_isError(ret)) {
+                fail(std::string("corrupt zstd data: ") + ZSTD_getErrorName(ret));
+                return false;
+            }
+            bool frameDone = (ret == 0);
+            if (out.pos == out.size || (frameDone && out.pos > 0)) {
+                chunk.resize(out.pos);
+                if (!emit(std::move(chunk))) return false;
+                chunk.assign(kChunkSize, '\0');
+                out = {&chunk[0], kChunkSize, 0};
+            }
+            if (frameDone) return true;
+            if (in.pos == in.size && out.pos == 0) {
+                fail("truncated zstd frame");
+                return false;
+            }
+        }
+    };
+
+    unsigned numWorkers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), frameList.size());
+    if (numWorkers <= 1) {
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        for (size_t f = 0; f < frameList.size(); ++f) {
+            if (!decompressFrame(f, dctx, [this](std::string&& c) { return push(std::move(c)); })) break;
+        }
+        ZSTD_freeDCtx(dctx);
+        munmap((void*)data, fileSize);
+        return;
+    }
+
+    // Parallel frames: up to `window` frames are decompressed at once, each
+    // streaming its pieces through its own queue of at most kMaxChunks, and
+    // this thread delivers the frames in order. Memory stays within
+    // window * kMaxChunks chunks however large a frame expands.
+    const size_t window = numWorkers;
+    struct FrameSlot {
+        std::deque<std::string> pieces;
+        int state = 0;      // 0: decompressing, 1: done, 2: failed
+    };
+    std::vector<FrameSlot> slotList(window);
+    std::mutex frameMutex;
+    std::condition_variable frameCv;
+    size_t delivered = 0;
+    bool stop = false;
+    std::atomic<size_t> nextFrame(0);
+
+    auto worker = [&]() {
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        for (size_t f; (f = nextFrame.fetch_add(1)) < frameList.size(); ) {
+            FrameSlot& slot = slotList[f % window];
+            {
+                std::unique_lock<std::mutex> lock(frameMutex);
+                frameCv.wait(lock, [&]() { return f < delivered + window || stop; });
+                if (stop) break;
+            }
+            bool ok = decompressFrame(f, dctx, [&](std::string&& c) {
+                std::unique_lock<std::mutex> lock(frameMutex);
+                frameCv.wait(lock, [&]() { return slot.pieces.size() < kMaxChunks || stop; });
+                if (stop) return false;
+                slot.pieces.push_back(std::move(c));
+                frameCv.notify_all();
+                return true;
+            });
+            std::lock_guard<std::mutex> lock(frameMutex);
+            slot.state = ok ? 1 : 2;
+            frameCv.notify_all();
+        }
+        ZSTD_freeDCtx(dctx);
+    };
+    std::vector<std::thread> workerList;
+    for (unsigned t = 0; t < numWorkers; ++t) {
+        workerList.emplace_back(worker);
+    }
+
+    for (size_t f = 0; f < frameList.size(); ++f) {
+        FrameSlot& slot = slotList[f % window];
+        bool ok = true;
+        while (ok) {
+            std::string piece;
+            {
+                std::unique_lock<std::mutex> lock(frameMutex);
+                frameCv.wait(lock, [&]() { return !slot.pieces.empty() || slot.state != 0; });
+                if (slot.pieces.empty()) break;
+                piece = std::move(slot.pieces.front());
+                slot.pieces.pop_front();
+                frameCv.notify_all();
+            }
+            ok = push(std::move(piece));
+        }
+        if (!ok || slot.state == 2) break;
+        std::lock_guard<std::mutex> lock(frameMutex);
+        slot.state = 0;
+        ++delivered;
+        frameCv.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        stop = true;
+        frameCv.notify_all();
+    }
+    for (auto& thread : workerList) {
+        thread.join();
+    }
+    munmap((void*)data, fileSize);
+#else
+    (void)fd;
+#endif
+}
+
+bool CompressedInput::inputFinish() {
+    while (true) {
+        while (_pos < _chunk.size() && isspace((unsigned char)_chunk[_pos])) ++_pos;
+        if (_pos < _chunk.size()) return false;
+        if (!nextChunk()) return true;
+    }
+}
+
+CompressedInput& CompressedInput::operator>>(std::string& token) {
+    token.clear();
+    if (inputFinish()) return *this;
+    while (true) {
+        size_t begin = _pos;
+        while (_pos < _chunk.size() && !isspace((unsigned char)_chunk[_pos])) ++_pos;
+        token.append(_chunk, begin, _pos - begin);
+        if (_pos < _chunk.size() || !nextChunk()) break;   // token may continue in the next chunk
+    }
+    return *this;
+}
+
+bool CompressedInput::skipPast(const std::string& marker) {
+    if (marker.empty()) return true;
+    std::string carry;      // last marker.size()-1 bytes of the previous chunk
+    while (true) {
+        if (!carry.empty()) {
+            std::string joint = carry + _chunk.substr(_pos, marker.size() - 1);
+            size_t hit = joint.find(marker);
+            if (hit != std::string::npos) {
+                _pos += hit + marker.size() - carry.size();
+                return true;
+            }
+        }
+        size_t hit = _chunk.find(marker, _pos);
+        if (hit != std::string::npos) {
+            _pos = hit + marker.size();
+            return true;
+        }
+        size_t keep = std::min(marker.size() - 1, _chunk.size() - _pos);
+        carry = _chunk.substr(_chunk.size() - keep);
+        _pos = _chunk.size();
+        if (!nextChunk()) return false;
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef COMPRESSED_INPUT_H
+#define COMPRESSED_INPUT_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Whitespace-tokenized input that reads plain, gzip or zstd files
+    The format is detected from the magic bytes, not the file name. A
+    background thread reads and decompresses the file into chunks of about
+    1 MB and hands them to the parser through a bounded queue (kMaxChunks), so
+    parsing overlaps decompression and the file is never expanded on disk.
+    Multi-frame zstd files (zstd -T / --long, pzstd) are split at frame
+    boundaries and the frames are decompressed in parallel, still delivered in
+    order through the same queue.
+    gzip needs zlib, zstd needs libzstd; either is compiled in only when its
+    header is found (__has_include), and opening such a file otherwise fails.
+The interface is the subset of IOPkg the LEF/DEF parsers use, plus byte
+offsets into the (decompressed) stream so that a parser can index sections
+on one pass and come back to them: offset() reports the position, skipPast()
+jumps over a section without tokenizing it, and a reader opened with a start
+offset begins there (plain files seek; compressed ones discard the prefix).
+*/
+
+class CompressedInput {
+public:
+    enum Format { PLAIN, GZIP, ZSTD };
+
+    explicit CompressedInput(const std::string& fileName, size_t startOffset = 0);
+    ~CompressedInput();
+    CompressedInput(const CompressedInput&) = delete;
+    CompressedInput& operator=(const CompressedInput&) = delete;
+
+    bool inputExist() const { return _exist; }
+    // True once only whitespace is left
+    bool inputFinish();
+    // Next whitespace-separated token; empty at end of input
+    CompressedInput& operator>>(std::string& token);
+    // Stream offset of the next unread byte
+    size_t offset() const { return _chunkOffset + _pos; }
+    // Advances to just past the next occurrence of marker; false at end of input
+    bool skipPast(const std::string& marker);
+
+    Format format() const { return _format; }
+    const std::string& error() const { return _error; }
+
+private:
+    static const size_t kChunkSize = 1 << 20;
+    static const size_t kMaxChunks = 8;
+
+    void produceFile(int fd);
+    void produceGzip(int fd);
+    void produceZstd(int fd);
+    // Blocks while the queue is full; returns false if the reader was closed
+    bool push(std::string&& chunk);
+    void fail(const std::string& message);
+    // Refills _chunk from the queue; returns false at end of input
+    bool nextChunk();
+
+    bool _exist = false;
+    Format _format = PLAIN;
+    std::string _fileName;
+    std::string _error;
+
+    std::mutex _mutex;
+    std::condition_variable _notEmpty, _notFull;
+    std::deque<std::string> _queue;
+    bool _done = false;
+    bool _closed = false;
+    std::thread _producer;
+
+    std::string _chunk;
+    size_t _pos = 0;
+    size_t _chunkOffset = 0;    // stream offset of _chunk
+    size_t _skip = 0;           // bytes still to discard (compressed start offset)
+};
+
+#endif // COMPRESSED_INPUT_H
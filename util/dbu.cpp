@@ -0,0 +1,34 @@
+#include <cassert>
+#include <cctype>
+#include "util/dbu.h"
+
+Dbu parseDbu(const std::string& micronStr, int dbuPerMicron) {
+    assert (dbuPerMicron > 0);
+    size_t i = 0;
+    bool negative = false;
+    if (i < micronStr.size() && (micronStr[i] == '-' || micronStr[i] == '+')) {
+        negative = (micronStr[i] == '-');
+        ++i;
+    }
+    Dbu intPart = 0;
+    for (; i < micronStr.size() && isdigit(micronStr[i]); ++i) {
+        intPart = intPart * 10 + (micronStr[i] - '0');
+    }
+    // Fraction as num / den with at most 15 digits. Later digits cannot change
+    // the rounding: every half-DBU boundary has at most 15 fraction digits for
+    // dbuPerMicron <= 20000 (the LEF maximum).
+    Dbu num = 0, den = 1;
+    if (i < micronStr.size() && micronStr[i] == '.') {
+        for (++i; i < micronStr.size() && isdigit(micronStr[i]); ++i) {
+            if (den < 1000000000000000LL) {
+                num = num * 10 + (micronStr[i] - '0');
+                den *= 10;
+            }
+        }
+    }
+    // num * dbuPerMicron can reach 1e15 * 20000, so the rounding is done in
+    // 128 bits
+    Dbu value = intPart * dbuPerMicron
+              + (Dbu)(((__int128)2 * num * dbuPerMicron + den) / (2 * den));
+    return negative ? -value : value;
+}
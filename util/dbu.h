@@ -0,0 +1,40 @@
+#ifndef DBU_H
+#define DBU_H
+
+#include <string>
+
+/*
+Integer database-unit (DBU) coordinates
+    All geometry in Chip, Row, Node, LibGate and Port is stored in DBU.
+    Micron values only appear at I/O: LEF numbers are converted exactly from
+    their decimal text with parseDbu, and dbuToMicron is used for output.
+*/
+
+using Dbu = long long;
+
+// Converts a decimal micron string ("0.096", "-1.5", "12") to DBU exactly,
+// rounding half away from zero below one DBU
+Dbu parseDbu(const std::string& micronStr, int dbuPerMicron);
+
+inline double dbuToMicron(Dbu value, int dbuPerMicron) {
+    return (double)value / dbuPerMicron;
+}
+
+// Largest site boundary <= x for sites of width step starting at origin
+inline Dbu snapDownToSite(Dbu x, Dbu origin, Dbu step) {
+    Dbu offset = x - origin;
+    Dbu q = offset / step;
+    if (offset % step != 0 && offset < 0) --q;
+    return origin + q * step;
+}
+
+inline bool isOnSite(Dbu x, Dbu origin, Dbu step) {
+    return (x - origin) % step == 0;
+}
+
+// Half-open intervals [a1, a2) and [b1, b2)
+inline bool overlaps(Dbu a1, Dbu a2, Dbu b1, Dbu b2) {
+    return a1 < b2 && b1 < a2;
+}
+
+#endif // DBU_H
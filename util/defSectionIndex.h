@@ -0,0 +1,47 @@
+#ifndef DEF_SECTION_INDEX_H
+#define DEF_SECTION_INDEX_H
+
+#include <string>
+#include <vector>
+
+/*
+Top-level sections of the parsed DEF file
+    offset is the stream offset (see CompressedInput::offset) just after the
+    section keyword, so a reader opened there starts with the entry count;
+    count is -1 for single statements (DIEAREA, the first ROW). Sections
+    that are not loaded were skipped by parseInputDef and are parsed on first
+    use (Legalizer::loadDefNets).
+*/
+
+struct DefSection {
+    std::string name;
+    size_t offset = 0;
+    long long count = -1;
+    bool loaded = false;
+};
+
+class DefSectionIndex {
+public:
+    void reset(const std::string& fileName) {
+        _fileName = fileName;
+        _sectionList.clear();
+    }
+    void add(const std::string& name, size_t offset, long long count, bool loaded) {
+        _sectionList.push_back({name, offset, count, loaded});
+    }
+    DefSection* find(const std::string& name) {
+        for (DefSection& section : _sectionList) {
+            if (section.name == name) return &section;
+        }
+        return nullptr;
+    }
+
+    const std::string& fileName() const { return _fileName; }
+    const std::vector<DefSection>& sectionList() const { return _sectionList; }
+
+private:
+    std::string _fileName;
+    std::vector<DefSection> _sectionList;
+};
+
+#endif // DEF_SECTION_INDEX_H
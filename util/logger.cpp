@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "util/logger.h"
+
+namespace {
+
+void flushAtExit() {
+    Logger::instance().flush();
+}
+
+} // namespace
+
+Logger& Logger::instance() {
+    // Never destroyed; the writer thread is drained by an atexit handler
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger()
+    : _level(NIMCH_LOG_LEVEL), _slots(new Slot[numSlots]), _tail(0), _head(0), _sleeping(false) {
+    for (size_t i = 0; i < numSlots; ++i) {
+        _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    const char* level = std::getenv("NIMCH_LOG_LEVEL");
+    if (level && *level) {
+        setLevel(std::atoi(level));
+    }
+    _writer = std::thread(&Logger::drain, this);
+    _writer.detach();
+    std::atexit(flushAtExit);
+}
+
+std::ostringstream& Logger::stream() {
+    thread_local std::ostringstream logStream;
+    logStream.str("");
+    logStream.clear();
+    return logStream;
+}
+
+void Logger::push(int level, const std::string& msg) {
+    size_t pos = _tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &_slots[pos & (numSlots - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        long diff = (long)seq - (long)pos;
+        if (diff == 0) {
+            if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) {
+            // Full: wait for the writer thread
+            std::this_thread::yield();
+            pos = _tail.load(std::memory_order_relaxed);
+        }
+        else {
+            pos = _tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    slot->len = std::min(msg.size(), slotBytes);
+    memcpy(slot->text, msg.data(), slot->len);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // Pairs with the fence in drain: either the writer sees this slot before
+    // it sleeps, or this sees it asleep and wakes it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _wake.notify_one();
+    }
+}
+
+void Logger::drain() {
+    while (true) {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        bool wroteOut = false, wroteErr = false;
+        while (true) {
+            Slot& slot = _slots[pos & (numSlots - 1)];
+            if (slot.seq.load(std::memory_order_acquire) != pos + 1) break;
+            FILE* sink = (slot.level <= NIMCH_LOG_WARN) ? stderr : stdout;
+            fwrite(slot.text, 1, slot.len, sink);
+            (sink == stderr ? wroteErr : wroteOut) = true;
+            slot.seq.store(pos + numSlots, std::memory_order_release);
+            _head.store(++pos, std::memory_order_release);
+        }
+        if (wroteOut) fflush(stdout);
+        if (wroteErr) fflush(stderr);
+        if (!wroteOut && !wroteErr) {
+            std::unique_lock<std::mutex> lock(_wakeMutex);
+            _sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            Slot& next = _slots[pos & (numSlots - 1)];
+            _wake.wait(lock, [&] { return next.seq.load(std::memory_order_acquire) == pos + 1; });
+            _sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::flush() {
+    size_t tail = _tail.load(std::memory_order_acquire);
+    while (_head.load(std::memory_order_acquire) < tail) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
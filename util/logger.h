@@ -0,0 +1,86 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/*
+Leveled asynchronous logger
+    Messages are formatted by the caller into a fixed-size slot of a bounded
+    lock-free ring buffer and written to stdout (INFO and below) or stderr
+    (WARN, ERROR) by a background thread, so hot loops never block on the
+    console. The writer sleeps on a condition variable while the buffer is
+    empty; producers only signal it when it is asleep. Messages longer than
+    a slot are truncated.
+    Levels above NIMCH_LOG_LEVEL (default: INFO) are removed at compile time;
+    levels above the runtime level (Logger::setLevel) cost one branch.
+*/
+
+#define NIMCH_LOG_ERROR 0
+#define NIMCH_LOG_WARN  1
+#define NIMCH_LOG_INFO  2
+#define NIMCH_LOG_DEBUG 3
+#define NIMCH_LOG_TRACE 4
+
+#ifndef NIMCH_LOG_LEVEL
+#define NIMCH_LOG_LEVEL NIMCH_LOG_INFO
+#endif
+
+class Logger {
+public:
+    static Logger& instance();
+
+    int level() const { return _level.load(std::memory_order_relaxed); }
+    void setLevel(int level) { _level.store(level, std::memory_order_relaxed); }
+
+    void push(int level, const std::string& msg);
+    // Blocks until every message pushed so far has been written
+    void flush();
+
+    static std::ostringstream& stream();
+
+private:
+    static const size_t slotBytes = 248;
+    static const size_t numSlots = 4096;    // power of two
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        int level;
+        unsigned len;
+        char text[slotBytes];
+    };
+
+    Logger();
+    void drain();
+
+    std::atomic<int> _level;
+    Slot* _slots;
+    alignas(64) std::atomic<size_t> _tail;  // next slot to write (producers)
+    alignas(64) std::atomic<size_t> _head;  // next slot to read (writer thread)
+    std::thread _writer;
+    std::atomic<bool> _sleeping;            // writer waits on _wake
+    std::mutex _wakeMutex;
+    std::condition_variable _wake;
+};
+
+#define NIMCH_LOG(lvl, expr) \
+    do { \
+        if ((lvl) <= NIMCH_LOG_LEVEL && (lvl) <= Logger::instance().level()) { \
+            std::ostringstream& _logStream = Logger::stream(); \
+            _logStream << expr; \
+            Logger::instance().push(lvl, _logStream.str()); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(expr) NIMCH_LOG(NIMCH_LOG_ERROR, expr)
+#define LOG_WARN(expr)  NIMCH_LOG(NIMCH_LOG_WARN, expr)
+#define LOG_INFO(expr)  NIMCH_LOG(NIMCH_LOG_INFO, expr)
+#define LOG_DEBUG(expr) NIMCH_LOG(NIMCH_LOG_DEBUG, expr)
+#define LOG_TRACE(expr) NIMCH_LOG(NIMCH_LOG_TRACE, expr)
+
+#endif // LOGGER_H
@@ -0,0 +1,80 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include "util/perfCounters.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+PerfCounters& PerfCounters::instance() {
+    static PerfCounters perfCounters;
+    return perfCounters;
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : _fd) {
+        if (fd != -1) close(fd);
+    }
+}
+
+const char* PerfCounters::eventName(int event) {
+    static const char* nameList[NUM_EVENTS] = {
+        "cycles", "instructions", "llc_misses", "branch_misses", "page_faults"
+    };
+    return nameList[event];
+}
+
+bool PerfCounters::open() {
+#ifdef __linux__
+    if (_available) return true;
+    const unsigned typeList[NUM_EVENTS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE
+    };
+    const unsigned long long configList[NUM_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_PAGE_FAULTS
+    };
+
+    bool anyOpen = false;
+    for (int e = 0; e < NUM_EVENTS; ++e) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = typeList[e];
+        attr.config = configList[e];
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        _fd[e] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (_fd[e] == -1) {
+            std::cerr << "Warning: perf counter " << eventName(e) << " unavailable ("
+                      << strerror(errno) << ")\n";
+            continue;
+        }
+        ioctl(_fd[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        anyOpen = true;
+    }
+    _available = anyOpen;
+    return _available;
+#else
+    std::cerr << "Warning: perf counters are only supported on Linux\n";
+    return false;
+#endif
+}
+
+void PerfCounters::read(long long values[NUM_EVENTS]) const {
+    for (int e = 0; e < NUM_EVENTS; ++e) {
+        values[e] = 0;
+        if (_fd[e] == -1) continue;
+        unsigned long long buf[3];  // value, time_enabled, time_running
+        if (::read(_fd[e], buf, sizeof(buf)) != sizeof(buf)) continue;
+        values[e] = (buf[2] == 0 || buf[2] == buf[1]) ? buf[0]
+                  : (long long)((double)buf[0] * buf[1] / buf[2]);
+    }
+}
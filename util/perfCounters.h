@@ -0,0 +1,39 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/*
+Hardware performance counters through perf_event_open (Linux only).
+    The counters count the whole process (inherited by threads created after
+    open()) and are read as free-running totals; phases take differences.
+    Values are scaled by time_enabled / time_running when the kernel
+    multiplexes counters.
+*/
+
+class PerfCounters {
+public:
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        PAGE_FAULTS,
+        NUM_EVENTS
+    };
+
+    static PerfCounters& instance();
+
+    bool open();
+    bool available() const { return _available; }
+    void read(long long values[NUM_EVENTS]) const;
+
+    static const char* eventName(int event);
+
+private:
+    PerfCounters() = default;
+    ~PerfCounters();
+
+    bool _available = false;
+    int _fd[NUM_EVENTS] = {-1, -1, -1, -1, -1};
+};
+
+#endif // PERF_COUNTERS_H
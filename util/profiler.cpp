@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sys/resource.h>
+#include "util/profiler.h"
+
+namespace {
+
+void dumpAtExit() {
+    Profiler::instance().dumpJson();
+}
+
+std::string jsonEscape(const std::string& str) {
+    std::string out;
+    for (char c : str) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+Profiler& Profiler::instance() {
+    // Never destroyed: the JSON is dumped by an atexit handler that may run
+    // after function-local statics are gone
+    static Profiler* profiler = new Profiler();
+    return *profiler;
+}
+
+Profiler::Profiler() {
+    const char* outJson = std::getenv("NIMCH_PROFILE");
+    if (outJson && *outJson) {
+        setOutput(outJson);
+        const char* perf = std::getenv("NIMCH_PERF");
+        if (perf && std::string(perf) == "1") {
+            enablePerf();
+        }
+    }
+}
+
+void Profiler::enablePerf() {
+    _perfEnabled = PerfCounters::instance().open();
+}
+
+void Profiler::setOutput(const std::string& outJson) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_enabled) {
+        std::atexit(dumpAtExit);
+    }
+    _outJson = outJson;
+    _enabled = true;
+}
+
+void Profiler::record(const std::string& name, double wallSec, double cpuSec,
+                      const long long* perfDelta) {
+    long rss = peakRssKB();
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _recordMap.find(name);
+    if (it == _recordMap.end()) {
+        _order.push_back(name);
+        it = _recordMap.emplace(name, Record()).first;
+    }
+    Record& rec = it->second;
+    ++rec.calls;
+    rec.wallSec += wallSec;
+    rec.cpuSec += cpuSec;
+    rec.peakRssKB = std::max(rec.peakRssKB, rss);
+    if (perfDelta) {
+        for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) rec.perf[e] += perfDelta[e];
+    }
+}
+
+void Profiler::count(const std::string& name, long long n) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _counterMap.find(name);
+    if (it == _counterMap.end()) {
+        _counterOrder.push_back(name);
+        _counterMap.emplace(name, n);
+    }
+    else {
+        it->second += n;
+    }
+}
+
+bool Profiler::dumpJson() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_enabled) return false;
+    std::ofstream outFile(_outJson);
+    if (!outFile.is_open()) return false;
+
+    // Placed cells, for per-cell miss rates
+    auto cellIt = _counterMap.find("components");
+    long long numCells = (cellIt == _counterMap.end()) ? 0 : cellIt->second;
+
+    outFile << "{\n  \"phases\": [\n";
+    for (size_t i = 0; i < _order.size(); ++i) {
+        const Record& rec = _recordMap.at(_order[i]);
+        outFile << "    {\"name\": \"" << jsonEscape(_order[i]) << "\""
+                << ", \"calls\": " << rec.calls
+                << ", \"wall_s\": " << rec.wallSec
+                << ", \"cpu_s\": " << rec.cpuSec
+                << ", \"peak_rss_kb\": " << rec.peakRssKB;
+        if (_perfEnabled) {
+            outFile << ", \"perf\": {";
+            for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+                outFile << "\"" << PerfCounters::eventName(e) << "\": " << rec.perf[e] << ", ";
+            }
+            long long cycles = rec.perf[PerfCounters::CYCLES];
+            outFile << "\"ipc\": " << (cycles ? (double)rec.perf[PerfCounters::INSTRUCTIONS] / cycles : 0.0);
+            if (numCells > 0) {
+                outFile << ", \"llc_misses_per_cell\": " << (double)rec.perf[PerfCounters::LLC_MISSES] / numCells
+                        << ", \"branch_misses_per_cell\": " << (double)rec.perf[PerfCounters::BRANCH_MISSES] / numCells;
+            }
+            outFile << "}";
+        }
+        outFile << "}" << (i + 1 < _order.size() ? ",\n" : "\n");
+    }
+    outFile << "  ],\n  \"counters\": {\n";
+    for (size_t i = 0; i < _counterOrder.size(); ++i) {
+        outFile << "    \"" << jsonEscape(_counterOrder[i]) << "\": " << _counterMap.at(_counterOrder[i])
+                << (i + 1 < _counterOrder.size() ? ",\n" : "\n");
+    }
+    outFile << "  },\n  \"peak_rss_kb\": " << peakRssKB() << "\n}\n";
+    return true;
+}
+
+double Profiler::wallNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double Profiler::cpuNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+long Profiler::peakRssKB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
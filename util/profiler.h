@@ -0,0 +1,122 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "util/perfCounters.h"
+
+/*
+Per-phase wall time, CPU time and peak RSS, plus named object counters.
+    Enabled by setting NIMCH_PROFILE=<out.json>; the JSON is written at exit.
+    When disabled, a ScopedTimer costs one predictable branch. Building with
+    -DNIMCH_NO_PROFILE removes the instrumentation entirely.
+    NIMCH_PERF=1 additionally records hardware counters per phase (see
+    PerfCounters) and reports IPC and misses per placed cell.
+*/
+
+class Profiler {
+public:
+    struct Record {
+        long long calls = 0;
+        double wallSec = 0;
+        double cpuSec = 0;
+        long peakRssKB = 0;
+        long long perf[PerfCounters::NUM_EVENTS] = {};
+    };
+
+    static Profiler& instance();
+
+    bool enabled() const { return _enabled; }
+    bool perfEnabled() const { return _perfEnabled; }
+    void setOutput(const std::string& outJson);
+    void enablePerf();
+
+    void record(const std::string& name, double wallSec, double cpuSec,
+                const long long* perfDelta = nullptr);
+    void count(const std::string& name, long long n);
+    bool dumpJson() const;
+
+    static double wallNow();
+    static double cpuNow();
+    static long peakRssKB();
+
+private:
+    Profiler();
+
+    bool _enabled = false;
+    bool _perfEnabled = false;
+    std::string _outJson;
+    mutable std::mutex _mutex;
+    std::vector<std::string> _order;    // first-seen order of phases
+    std::unordered_map<std::string, Record> _recordMap;
+    std::vector<std::string> _counterOrder;
+    std::unordered_map<std::string, long long> _counterMap;
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) {
+        if (Profiler::instance().enabled()) start(name);
+    }
+    explicit ScopedTimer(const std::string& name) {
+        if (Profiler::instance().enabled()) start(name);
+    }
+    ~ScopedTimer() {
+        stop();
+    }
+    // Ends the phase before the end of the enclosing scope
+    void stop() {
+        if (_active) {
+            _active = false;
+            Profiler& profiler = Profiler::instance();
+            if (profiler.perfEnabled()) {
+                long long perf[PerfCounters::NUM_EVENTS];
+                PerfCounters::instance().read(perf);
+                for (int e = 0; e < PerfCounters::NUM_EVENTS; ++e) perf[e] -= _perf[e];
+                profiler.record(_name, Profiler::wallNow() - _wall, Profiler::cpuNow() - _cpu, perf);
+            }
+            else {
+                profiler.record(_name, Profiler::wallNow() - _wall, Profiler::cpuNow() - _cpu);
+            }
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    void start(const std::string& name) {
+        _active = true;
+        _name = name;
+        _wall = Profiler::wallNow();
+        _cpu = Profiler::cpuNow();
+        if (Profiler::instance().perfEnabled()) {
+            PerfCounters::instance().read(_perf);
+        }
+    }
+
+    bool _active = false;
+    std::string _name;
+    double _wall = 0;
+    double _cpu = 0;
+    long long _perf[PerfCounters::NUM_EVENTS] = {};
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifndef NIMCH_NO_PROFILE
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(_profileScope, __LINE__)(name)
+// A named phase that can end before the enclosing scope
+#define PROFILE_BEGIN(timer, name) ScopedTimer timer(name)
+#define PROFILE_END(timer) timer.stop()
+#define PROFILE_COUNT(name, n) \
+    do { if (Profiler::instance().enabled()) Profiler::instance().count(name, n); } while (0)
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#define PROFILE_BEGIN(timer, name) do {} while (0)
+#define PROFILE_END(timer) do {} while (0)
+#define PROFILE_COUNT(name, n) do {} while (0)
+#endif
+
+#endif // PROFILER_H
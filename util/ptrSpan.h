@@ -0,0 +1,50 @@
+#ifndef PTR_SPAN_H
+#define PTR_SPAN_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*
+Non-owning view of a std::vector<std::shared_ptr<T>> that yields raw T*
+    Iterating a vector of shared_ptr by value (for (sPtr<T> p : list)) or
+    copying it costs two atomic reference-count updates per element; a
+    PtrSpan only reads the stored pointers. Ownership stays in the vector,
+    which must outlive the span and not be resized while it is in use.
+        for (LibGate* libGate : ptrSpan(_getCandidateGates(intNode))) ...
+*/
+
+template <class T>
+class PtrSpan {
+public:
+    class iterator {
+    public:
+        explicit iterator(const std::shared_ptr<T>* p) : _p(p) {}
+        T* operator*() const { return _p->get(); }
+        iterator& operator++() { ++_p; return *this; }
+        bool operator==(const iterator& other) const { return _p == other._p; }
+        bool operator!=(const iterator& other) const { return _p != other._p; }
+    private:
+        const std::shared_ptr<T>* _p;
+    };
+
+    PtrSpan() = default;
+    PtrSpan(const std::vector<std::shared_ptr<T>>& list) : _data(list.data()), _size(list.size()) {}
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    T* operator[](size_t i) const { return _data[i].get(); }
+    iterator begin() const { return iterator(_data); }
+    iterator end() const { return iterator(_data + _size); }
+
+private:
+    const std::shared_ptr<T>* _data = nullptr;
+    size_t _size = 0;
+};
+
+template <class T>
+PtrSpan<T> ptrSpan(const std::vector<std::shared_ptr<T>>& list) {
+    return PtrSpan<T>(list);
+}
+
+#endif // PTR_SPAN_H